@@ -0,0 +1,156 @@
+/*
+ * batch.cpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include "batch.hpp"
+
+/*
+ * Batch constructor (zero threads sizes the pool to the machine)
+ */
+batch::batch(size_t threads) : workers(threads) {
+	return;
+}
+
+/*
+ * Batch destructor
+ */
+batch::~batch(void) {
+	return;
+}
+
+/*
+ * Add a job running an image loaded at an offset until it halts,
+ * reaches an idle loop or spends a budget of cycles (zero runs
+ * without a budget)
+ */
+void batch::add(const std::vector<word> &image, word offset, size_t limit) {
+	job entry;
+
+	entry.start = NULL;
+	entry.image = image;
+	entry.offset = offset;
+	entry.limit = limit;
+	jobs.push_back(entry);
+}
+
+/*
+ * Add a job forked from a snapshot, writing a patch at an offset
+ * before it runs for a budget of cycles (the snapshot must outlive
+ * the run)
+ */
+void batch::add(snapshot &start, const std::vector<word> &patch, word offset, size_t limit) {
+	job entry;
+
+	entry.start = &start;
+	entry.image = patch;
+	entry.offset = offset;
+	entry.limit = limit;
+	jobs.push_back(entry);
+}
+
+/*
+ * Collect a job result from a cpu and the reason its run stopped
+ */
+void batch::collect(dcpu &cpu, word reason, result &res) {
+
+	// collect registers, cycles & exit reason
+	for(word i = 0; i < dcpu::M_REG_COUNT; ++i)
+		res.reg[i] = cpu.m_register(i).get();
+	for(word i = 0; i < dcpu::S_REG_COUNT; ++i)
+		res.reg[dcpu::M_REG_COUNT + i] = cpu.s_register(i).get();
+	res.cycle = cpu.cycles();
+	if(reason == dcpu::IDLE)
+		res.reason = IDLE;
+	else
+		res.reason = cpu.is_running() ? LIMIT : HALTED;
+}
+
+/*
+ * Return a job result
+ */
+const batch::result &batch::at(size_t job) {
+	return results.at(job);
+}
+
+/*
+ * Remove all jobs
+ */
+void batch::clear(void) {
+	jobs.clear();
+	results.clear();
+}
+
+/*
+ * Run all jobs across the pool, returning when every job is done
+ */
+void batch::run(word engine) {
+	results.assign(jobs.size(), result());
+
+	// jobs reuse one cpu per worker
+	for(size_t i = 0; i < workers.size(); ++i)
+		cpus.push_back(new dcpu(engine));
+	for(size_t i = 0; i < jobs.size(); ++i)
+		workers.submit(std::bind(&batch::run_job, this, i));
+	workers.wait();
+	for(size_t i = 0; i < cpus.size(); ++i)
+		delete cpus[i];
+	cpus.clear();
+}
+
+/*
+ * Run a single job
+ */
+void batch::run_job(size_t index) {
+	const job &entry = jobs[index];
+	dcpu &cpu = *cpus[pool::index()];
+	word reason;
+
+	// restore forked jobs, or clear memory (only pages the last
+	// job wrote) for image jobs
+	if(entry.start)
+		entry.start->restore(cpu);
+	else {
+		cpu.reset();
+		cpu.memory().clear();
+	}
+
+	// load image (or patch) at offset
+	if(!entry.image.empty())
+		cpu.memory().set(entry.offset, std::min<dword>(entry.image.size(), COUNT - entry.offset),
+				&entry.image[0]);
+
+	// run image (resuming cpus forked while running)
+	reason = cpu.run(entry.limit ? entry.limit : SIZE_MAX);
+	collect(cpu, reason, results[index]);
+}
+
+/*
+ * Return the number of jobs
+ */
+size_t batch::size(void) {
+	return jobs.size();
+}
+
+/*
+ * Return the number of worker threads
+ */
+size_t batch::threads(void) {
+	return workers.size();
+}
@@ -0,0 +1,148 @@
+/*
+ * batch.hpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCH_HPP_
+#define BATCH_HPP_
+
+#include <vector>
+#include "dcpu.hpp"
+#include "pool.hpp"
+#include "snapshot.hpp"
+#include "types.hpp"
+
+class batch {
+public:
+
+	/*
+	 * Job exit reasons
+	 */
+	enum REASON { HALTED, LIMIT, IDLE };
+
+	/*
+	 * Job result (final registers, cycle count & exit reason)
+	 */
+	typedef struct {
+		word reg[dcpu::REG_COUNT];
+		size_t cycle;
+		word reason;
+	} result;
+
+	/*
+	 * Batch constructor (zero threads sizes the pool to the machine)
+	 */
+	batch(size_t threads = 0);
+
+	/*
+	 * Batch destructor
+	 */
+	virtual ~batch(void);
+
+	/*
+	 * Add a job running an image loaded at an offset until it halts,
+	 * reaches an idle loop or spends a budget of cycles (zero runs
+	 * without a budget)
+	 */
+	void add(const std::vector<word> &image, word offset = 0, size_t limit = 0);
+
+	/*
+	 * Add a job forked from a snapshot, writing a patch at an offset
+	 * before it runs for a budget of cycles (the snapshot must outlive
+	 * the run)
+	 */
+	void add(snapshot &start, const std::vector<word> &patch, word offset = 0, size_t limit = 0);
+
+	/*
+	 * Return a job result
+	 */
+	const result &at(size_t job);
+
+	/*
+	 * Remove all jobs
+	 */
+	void clear(void);
+
+	/*
+	 * Run all jobs across the pool, returning when every job is done
+	 */
+	void run(word engine = dcpu::INTERP);
+
+	/*
+	 * Return the number of jobs
+	 */
+	size_t size(void);
+
+	/*
+	 * Return the number of worker threads
+	 */
+	size_t threads(void);
+
+private:
+
+	/*
+	 * Batch job
+	 */
+	typedef struct {
+		snapshot *start;
+		std::vector<word> image;
+		word offset;
+		size_t limit;
+	} job;
+
+	/*
+	 * Worker pool
+	 */
+	pool workers;
+
+	/*
+	 * Jobs
+	 */
+	std::vector<job> jobs;
+
+	/*
+	 * Job results (one per job)
+	 */
+	std::vector<result> results;
+
+	/*
+	 * Worker cpus (one per worker, reused across jobs)
+	 */
+	std::vector<dcpu *> cpus;
+
+	/*
+	 * Batch constructor
+	 */
+	batch(const batch &other);
+
+	/*
+	 * Batch assignment operator
+	 */
+	batch &operator=(const batch &other);
+
+	/*
+	 * Collect a job result from a cpu and the reason its run stopped
+	 */
+	void collect(dcpu &cpu, word reason, result &res);
+
+	/*
+	 * Run a single job
+	 */
+	void run_job(size_t index);
+};
+
+#endif
@@ -0,0 +1,1631 @@
+/*
+ * bench.cpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "batch.hpp"
+#include "cfg.hpp"
+#include "dcpu.hpp"
+#include "decode.hpp"
+#include "loader.hpp"
+#include "lockstep.hpp"
+#include "pacer.hpp"
+#include "profiler.hpp"
+#include "replay.hpp"
+#include "sampler.hpp"
+#include "scheduler.hpp"
+#include "snapshot.hpp"
+#include "tracer.hpp"
+#include "types.hpp"
+
+/*
+ * Loop program counts
+ */
+static const word OUTER = 0x0100;
+static const word INNER = 0x4000;
+
+/*
+ * Loop program (OUTER * ((5 * INNER) + 3) instructions)
+ *
+ * 	0x00:	SET X, OUTER
+ * 	0x02:	SET A, INNER
+ * 	0x04:	ADD B, A
+ * 	0x05:	XOR C, B
+ * 	0x06:	SUB A, 1
+ * 	0x07:	IFN A, 0
+ * 	0x08:	SET PC, 0x04
+ * 	0x09:	SUB X, 1
+ * 	0x0A:	IFN X, 0
+ * 	0x0B:	SET PC, 0x02
+ */
+static const word LOOP[] = {
+	0x7C31, OUTER, 0x7C01, INNER, 0x0012, 0x042B, 0x8403, 0x800D,
+	0x91C1, 0x8433, 0x803D, 0x89C1,
+};
+
+/*
+ * Arithmetic program (register, literal and memory operands)
+ *
+ * 	0x00:	SET I, 0x4000
+ * 	0x02:	SET Z, 0x1000
+ * 	0x04:	SET A, 7
+ * 	0x05:	MUL A, B
+ * 	0x06:	ADD B, 31
+ * 	0x07:	SHL C, 3
+ * 	0x08:	SHR A, 1
+ * 	0x09:	XOR C, A
+ * 	0x0A:	BOR X, C
+ * 	0x0B:	AND X, 30
+ * 	0x0C:	IFG A, B
+ * 	0x0D:	SUB B, A
+ * 	0x0E:	IFB C, 1
+ * 	0x0F:	ADD Y, 1
+ * 	0x10:	SET [Z], Y
+ * 	0x11:	ADD Z, 1
+ * 	0x12:	SUB I, 1
+ * 	0x13:	IFN I, 0
+ * 	0x14:	SET PC, 0x04
+ */
+static const word ARITH[] = {
+	0x7C61, 0x4000, 0x7C51, 0x1000, 0x9C01, 0x0404, 0xFC12, 0x8C27,
+	0x8408, 0x002B, 0x083A, 0xF839, 0x040E, 0x0013, 0x842F, 0x8442,
+	0x10D1, 0x8452, 0x8463, 0x806D, 0x91C1,
+};
+
+/*
+ * Self-modifying program (toggles ADD A, 1 and ADD A, 2)
+ *
+ * 	0x00:	SET I, 0x1000
+ * 	0x02:	ADD A, 1
+ * 	0x03:	XOR [0x02], 0x0C00
+ * 	0x06:	SUB I, 1
+ * 	0x07:	IFN I, 0
+ * 	0x08:	SET PC, 0x02
+ */
+static const word SMC[] = {
+	0x7C61, 0x1000, 0x8402, 0x7DEB, 0x0002, 0x0C00, 0x8463, 0x806D,
+	0x89C1,
+};
+
+/*
+ * Branch program count
+ */
+static const word BRANCH_COUNT = 0x4000;
+
+/*
+ * Branch program (failing conditionals skipping long and chained commands,
+ * BRANCH_COUNT * 5 commands run)
+ *
+ * 	0x00:	SET I, BRANCH_COUNT
+ * 	0x02:	IFG A, I
+ * 	0x03:	SET [0x1000+I], [0x2000]
+ * 	0x06:	IFE A, 1
+ * 	0x07:	IFN B, 0
+ * 	0x08:	ADD [0x3000], 0x1234
+ * 	0x0B:	SUB I, 1
+ * 	0x0C:	IFN I, 0
+ * 	0x0D:	SET PC, 0x02
+ */
+static const word BRANCH[] = {
+	0x7C61, BRANCH_COUNT, 0x180E, 0x7961, 0x1000, 0x2000, 0x840C, 0x801D,
+	0x7DE2, 0x3000, 0x1234, 0x8463, 0x806D, 0x89C1,
+};
+
+/*
+ * Call program (nested subroutine calls)
+ *
+ * 	0x00:	SET I, 0x1000
+ * 	0x02:	JSR 0x08
+ * 	0x04:	SUB I, 1
+ * 	0x05:	IFN I, 0
+ * 	0x06:	SET PC, 0x02
+ * 	0x08:	SET A, 0x10
+ * 	0x09:	JSR 0x0D
+ * 	0x0B:	SET PC, POP
+ * 	0x0D:	SUB A, 1
+ * 	0x0E:	IFN A, 0
+ * 	0x0F:	SET PC, 0x0D
+ * 	0x10:	SET PC, POP
+ */
+static const word CALLS[] = {
+	0x7C61, 0x1000, 0x7C10, 0x0008, 0x8463, 0x806D, 0x89C1, 0x0000,
+	0xC001, 0x7C10, 0x000D, 0x61C1, 0x0000, 0x8403, 0x800D, 0xB5C1,
+	0x61C1,
+};
+
+/*
+ * Hash program count
+ */
+static const word HASH_COUNT = 0x4000;
+
+/*
+ * Hash program (register-only, seeded through A, 1 + (8 * HASH_COUNT) instructions)
+ *
+ * 	0x00:	SET I, HASH_COUNT
+ * 	0x02:	MUL A, 31
+ * 	0x03:	ADD A, 13
+ * 	0x04:	XOR B, A
+ * 	0x05:	SHL B, 1
+ * 	0x06:	ADD C, B
+ * 	0x07:	SUB I, 1
+ * 	0x08:	IFN I, 0
+ * 	0x09:	SET PC, 0x02
+ */
+static const word HASH[] = {
+	0x7C61, HASH_COUNT, 0xFC04, 0xB402, 0x001B, 0x8417, 0x0422, 0x8463,
+	0x806D, 0x89C1,
+};
+
+/*
+ * Stack program count
+ */
+static const word STACK_COUNT = 0x1000;
+
+/*
+ * Stack program (registers saved & restored around a call,
+ * 1 + (11 * STACK_COUNT) instructions)
+ *
+ * 	0x00:	SET I, STACK_COUNT
+ * 	0x02:	JSR 0x08
+ * 	0x03:	SUB I, 1
+ * 	0x04:	IFN I, 0
+ * 	0x05:	SET PC, 0x02
+ * 	0x08:	SET PUSH, A
+ * 	0x09:	SET PUSH, B
+ * 	0x0A:	ADD A, I
+ * 	0x0B:	XOR B, A
+ * 	0x0C:	ADD C, B
+ * 	0x0D:	SET B, POP
+ * 	0x0E:	SET A, POP
+ * 	0x0F:	SET PC, POP
+ */
+static const word STACK[] = {
+	0x7C61, STACK_COUNT, 0xA010, 0x8463, 0x806D, 0x89C1, 0x0000, 0x0000,
+	0x01A1, 0x05A1, 0x1802, 0x001B, 0x0422, 0x6011, 0x6001, 0x61C1,
+};
+
+/*
+ * Idle programs (count down, then halt with a self-jump or wait for
+ * A to be set)
+ *
+ * 	0x00:	SET I, 0x1000
+ * 	0x02:	SUB I, 1
+ * 	0x03:	IFN I, 0
+ * 	0x04:	SET PC, 0x02
+ * 	0x05:	SUB PC, 1		(HALT)
+ *
+ * 	0x05:	IFN A, 1		(WAIT)
+ * 	0x06:	SET PC, 0x05
+ */
+static const word HALT[] = {
+	0x7C61, 0x1000, 0x8463, 0x806D, 0x89C1, 0x85C3,
+};
+static const word WAIT[] = {
+	0x7C61, 0x1000, 0x8463, 0x806D, 0x89C1, 0x840D, 0x95C1,
+};
+
+/*
+ * Divergent idle program (lanes with B set halt, the others spin)
+ *
+ * 	0x00:	IFE B, 0
+ * 	0x01:	SET PC, 0x03
+ * 	0x02:	(invalid)
+ * 	0x03:	SUB A, B
+ * 	0x04:	SET PC, 0x03
+ */
+static const word DIVERGE[] = {
+	0x801C, 0x8DC1, 0x0000, 0x0403, 0x8DC1,
+};
+
+/*
+ * Program corpus
+ */
+static const struct {
+	const char *name;
+	const word *prog;
+	size_t len;
+} CORPUS[] = {
+	{ "loop", LOOP, sizeof(LOOP) / sizeof(word) },
+	{ "arith", ARITH, sizeof(ARITH) / sizeof(word) },
+	{ "smc", SMC, sizeof(SMC) / sizeof(word) },
+	{ "hash", HASH, sizeof(HASH) / sizeof(word) },
+	{ "stack", STACK, sizeof(STACK) / sizeof(word) },
+};
+
+/*
+ * Return elapsed seconds since a given time
+ */
+static double elapsed(const std::chrono::steady_clock::time_point &start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*
+ * Load a program into a cpu
+ */
+static void load(dcpu &cpu, const word *prog, size_t len) {
+	cpu.reset();
+	cpu.memory().clear();
+	for(size_t i = 0; i < len; ++i)
+		cpu.memory().set(i, prog[i]);
+}
+
+/*
+ * Return if two cpus hold identical state
+ */
+static bool same(dcpu &lhs, dcpu &rhs) {
+
+	// compare registers
+	for(word i = 0; i < dcpu::M_REG_COUNT; ++i)
+		if(lhs.m_register(i) != rhs.m_register(i))
+			return false;
+	for(word i = 0; i < dcpu::S_REG_COUNT; ++i)
+		if(lhs.s_register(i) != rhs.s_register(i))
+			return false;
+
+	// compare memory
+	for(dword i = 0; i < COUNT; ++i)
+		if(lhs.memory().at(i) != rhs.memory().at(i))
+			return false;
+	return lhs.cycles() == rhs.cycles()
+			&& lhs.is_running() == rhs.is_running();
+}
+
+/*
+ * Run a loaded cpu, returning elapsed seconds
+ */
+static double timed_run(dcpu &cpu) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	cpu.run();
+	return elapsed(start);
+}
+
+/*
+ * Decode opcode, A & B bit by bit (pre-table decoder)
+ */
+static void decode_bits(word op, word &code, word &a, word &b) {
+	code = 0;
+	a = 0;
+	b = 0;
+
+	// parse opt-code, A & B from opt
+	for(size_t i = 0; i < 8 * sizeof(word); ++i)
+
+		// parse code
+		if(i < dcpu::B_OP_LEN) {
+			if(op & (1 << i))
+				code |= (1 << i);
+
+		// parse A
+		} else if(i >= dcpu::B_OP_LEN && i < dcpu::B_OP_LEN + dcpu::INPUT_LEN) {
+			if(op & (1 << i))
+				a |= (1 << (i - dcpu::B_OP_LEN));
+
+		// parse B
+		} else {
+			if(op & (1 << i))
+				b |= (1 << (i - (dcpu::B_OP_LEN + dcpu::INPUT_LEN)));
+		}
+}
+
+/*
+ * Decode opcode, A & B bit by bit, returning their sum
+ */
+static dword decode_sum(word op) {
+	word code, a, b;
+	decode_bits(op, code, a, b);
+	return code + a + b;
+}
+
+/*
+ * Decode opcode, A & B through the decode table
+ */
+static dword decode_table(word op) {
+	const decode::op &entry = decode::at(op);
+	return entry.code + entry.a + entry.b;
+}
+
+/*
+ * Pre-table interpreter state (flat registers & memory)
+ */
+typedef struct {
+	word reg[dcpu::REG_COUNT];
+	word mem[COUNT];
+} bits_cpu;
+
+/*
+ * Returns if an operand value reads a next word
+ */
+static bool next_bits(word value) {
+	return (value >= dcpu::L_OFF && value <= dcpu::H_OFF)
+			|| value == dcpu::ADR_OFF
+			|| value == dcpu::LIT_OFF;
+}
+
+/*
+ * Return the location of an operand through the pre-table operand
+ * switch (literals are copied into literal)
+ */
+static word *operand_bits(bits_cpu &cpu, word value, word &literal) {
+	word *reg = cpu.reg;
+
+	// register value
+	if(value <= dcpu::H_REG)
+		return &reg[value];
+
+	// value at address in register
+	if(value <= dcpu::H_VAL)
+		return &cpu.mem[reg[value % dcpu::M_REG_COUNT]];
+
+	// value at address (next word + register value)
+	if(value <= dcpu::H_OFF) {
+		word offset = cpu.mem[reg[dcpu::R_PC]++];
+		return &cpu.mem[(word) (offset + reg[value % dcpu::M_REG_COUNT])];
+	}
+	switch(value) {
+		case dcpu::POP:
+			return &cpu.mem[reg[dcpu::R_SP]++];
+		case dcpu::PEEK:
+			return &cpu.mem[reg[dcpu::R_SP]];
+		case dcpu::PUSH:
+			return &cpu.mem[--reg[dcpu::R_SP]];
+		case dcpu::SP_VAL:
+			return &reg[dcpu::R_SP];
+		case dcpu::PC_VAL:
+			return &reg[dcpu::R_PC];
+		case dcpu::OVER_F:
+			return &reg[dcpu::R_OVERFLOW];
+		case dcpu::ADR_OFF:
+			return &cpu.mem[cpu.mem[reg[dcpu::R_PC]++]];
+		case dcpu::LIT_OFF:
+			return &cpu.mem[reg[dcpu::R_PC]++];
+		default:
+			literal = value % dcpu::LIT_COUNT;
+			return &literal;
+	}
+}
+
+/*
+ * Skip the command at PC (and any chained conditionals) through the
+ * pre-table decoder
+ */
+static void skip_bits(bits_cpu &cpu) {
+	word code, a, b;
+	dword count = 0;
+
+	do {
+		decode_bits(cpu.mem[cpu.reg[dcpu::R_PC]], code, a, b);
+		cpu.reg[dcpu::R_PC] += 1 + (code ? next_bits(a) : 0)
+				+ ((code || a == dcpu::JSR) ? next_bits(b) : 0);
+	} while(code >= dcpu::IFE
+			&& ++count < COUNT);
+}
+
+/*
+ * Run the command at PC through the pre-table path (bit decoding,
+ * operand switch & opcode switch), returning false on a malformed
+ * command
+ */
+static bool exec_bits(bits_cpu &cpu, size_t &count) {
+	word code, a, b, a_lit, b_lit, *a_addr, a_val, b_val;
+	word *reg = cpu.reg;
+	dword res;
+	bool cond;
+
+	// decode command & increment pc by one
+	decode_bits(cpu.mem[reg[dcpu::R_PC]++], code, a, b);
+	++count;
+
+	// non-basic commands hold their operand in B (only JSR is valid)
+	if(code == dcpu::NB) {
+		if(a != dcpu::JSR)
+			return false;
+		b_val = *operand_bits(cpu, b, b_lit);
+		cpu.mem[--reg[dcpu::R_SP]] = reg[dcpu::R_PC];
+		reg[dcpu::R_PC] = b_val;
+		return true;
+	}
+
+	// retrieve operands
+	a_addr = operand_bits(cpu, a, a_lit);
+	a_val = *a_addr;
+	b_val = *operand_bits(cpu, b, b_lit);
+
+	// execute command
+	switch(code) {
+		case dcpu::SET:
+			*a_addr = b_val;
+			return true;
+		case dcpu::ADD:
+			res = a_val + b_val;
+			reg[dcpu::R_OVERFLOW] = (res >= HIGH) ? FLAG : LOW;
+			*a_addr = res;
+			return true;
+		case dcpu::SUB:
+			reg[dcpu::R_OVERFLOW] = (b_val > a_val) ? HIGH : LOW;
+			*a_addr = a_val - b_val;
+			return true;
+		case dcpu::MUL:
+			reg[dcpu::R_OVERFLOW] = ((a_val * b_val) >> 16) & HIGH;
+			*a_addr = a_val * b_val;
+			return true;
+		case dcpu::DIV:
+			reg[dcpu::R_OVERFLOW] = b_val ? ((a_val << 16) / b_val) & HIGH : LOW;
+			*a_addr = b_val ? a_val / b_val : LOW;
+			return true;
+		case dcpu::MOD:
+			*a_addr = b_val ? a_val % b_val : LOW;
+			return true;
+		case dcpu::SHL:
+			b_val &= dcpu::SHIFT_MASK;
+			reg[dcpu::R_OVERFLOW] = ((a_val << b_val) >> 16) & HIGH;
+			*a_addr = a_val << b_val;
+			return true;
+		case dcpu::SHR:
+			b_val &= dcpu::SHIFT_MASK;
+			reg[dcpu::R_OVERFLOW] = ((a_val << 16) >> b_val) & HIGH;
+			*a_addr = a_val >> b_val;
+			return true;
+		case dcpu::AND:
+			*a_addr = a_val & b_val;
+			return true;
+		case dcpu::BOR:
+			*a_addr = a_val | b_val;
+			return true;
+		case dcpu::XOR:
+			*a_addr = a_val ^ b_val;
+			return true;
+		case dcpu::IFE:
+			cond = a_val == b_val;
+			break;
+		case dcpu::IFN:
+			cond = a_val != b_val;
+			break;
+		case dcpu::IFG:
+			cond = a_val > b_val;
+			break;
+		default:
+			cond = a_val & b_val;
+			break;
+	}
+
+	// run the next command (stepping over a malformed one), or skip it
+	if(cond)
+		exec_bits(cpu, count);
+	else
+		skip_bits(cpu);
+	return true;
+}
+
+/*
+ * Run a program through the pre-table path until it halts, returning
+ * elapsed seconds (commands run are counted into count)
+ */
+static double run_bits(bits_cpu &cpu, const word *prog, size_t len, size_t &count) {
+	std::memset(&cpu, 0, sizeof(cpu));
+	std::memcpy(cpu.mem, prog, len * sizeof(word));
+	count = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while(exec_bits(cpu, count));
+	return elapsed(start);
+}
+
+/*
+ * Return if the pre-table path & a cpu hold identical registers & memory
+ */
+static bool same_bits(bits_cpu &bits, dcpu &cpu) {
+
+	// compare registers
+	for(word i = 0; i < dcpu::M_REG_COUNT; ++i)
+		if(bits.reg[i] != cpu.m_register(i).get())
+			return false;
+	for(word i = 0; i < dcpu::S_REG_COUNT; ++i)
+		if(bits.reg[dcpu::M_REG_COUNT + i] != cpu.s_register(i).get())
+			return false;
+
+	// compare memory
+	for(dword i = 0; i < COUNT; ++i)
+		if(bits.mem[i] != cpu.memory().at(i))
+			return false;
+	return true;
+}
+
+/*
+ * Benchmark decoding every opcode word
+ */
+static void bench_decode(void) {
+	const size_t rounds = 0x100;
+	volatile dword sink = 0;
+
+	// bit by bit decoder
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for(size_t r = 0; r < rounds; ++r)
+		for(dword i = 0; i < COUNT; ++i)
+			sink = sink + decode_sum((word) (i ^ r));
+	double bits = elapsed(start);
+
+	// table decoder
+	start = std::chrono::steady_clock::now();
+	for(size_t r = 0; r < rounds; ++r)
+		for(dword i = 0; i < COUNT; ++i)
+			sink = sink + decode_table((word) (i ^ r));
+	double table = elapsed(start);
+	std::cout << "decode: bits " << (rounds * COUNT / bits) / 1e6 << " Mop/s, table "
+			<< (rounds * COUNT / table) / 1e6 << " Mop/s" << std::endl;
+}
+
+/*
+ * Benchmark the interpreter on the loop program, comparing the corpus
+ * against the pre-table path
+ */
+static void bench_interp(void) {
+	dcpu cpu;
+	bits_cpu *bits = new bits_cpu();
+	size_t count = (size_t) OUTER * ((5 * (size_t) INNER) + 3);
+
+	// run every program in the corpus through both paths
+	for(size_t i = 0; i < sizeof(CORPUS) / sizeof(CORPUS[0]); ++i) {
+		size_t run;
+		double bits_time = run_bits(*bits, CORPUS[i].prog, CORPUS[i].len, run);
+		load(cpu, CORPUS[i].prog, CORPUS[i].len);
+		double table_time = timed_run(cpu);
+		std::cout << "interp: " << CORPUS[i].name << " bits " << (run / bits_time) / 1e6
+				<< " Minst/s, table " << (run / table_time) / 1e6 << " Minst/s, state "
+				<< (same_bits(*bits, cpu) ? "identical" : "DIFFERS") << std::endl;
+	}
+	delete bits;
+
+	// run loop program
+	load(cpu, LOOP, sizeof(LOOP) / sizeof(word));
+	double time = timed_run(cpu);
+	std::cout << "interp: " << (count / time) / 1e6 << " Minst/s, "
+			<< (cpu.cycles() / time) / 1e6 << " Mcycle/s" << std::endl;
+}
+
+/*
+ * Benchmark the threaded engine against the interpreter on the loop program
+ */
+static void bench_threaded(void) {
+	dcpu interp(dcpu::INTERP), threaded(dcpu::THREADED);
+	size_t count = (size_t) OUTER * ((5 * (size_t) INNER) + 3);
+
+	// run loop program on both engines
+	load(interp, LOOP, sizeof(LOOP) / sizeof(word));
+	load(threaded, LOOP, sizeof(LOOP) / sizeof(word));
+	double interp_time = timed_run(interp);
+	double threaded_time = timed_run(threaded);
+	std::cout << "threaded: interp " << (count / interp_time) / 1e6 << " Minst/s, threaded "
+			<< (count / threaded_time) / 1e6 << " Minst/s, state "
+			<< (same(interp, threaded) ? "identical" : "DIFFERS") << std::endl;
+}
+
+/*
+ * Benchmark the jit against the interpreter, validating the corpus
+ */
+static void bench_jit(void) {
+	dcpu interp(dcpu::INTERP), compiled(dcpu::JIT);
+	size_t count = (size_t) OUTER * ((5 * (size_t) INNER) + 3);
+
+	// validate every program in the corpus
+	for(size_t i = 0; i < sizeof(CORPUS) / sizeof(CORPUS[0]); ++i) {
+		load(interp, CORPUS[i].prog, CORPUS[i].len);
+		load(compiled, CORPUS[i].prog, CORPUS[i].len);
+		interp.run();
+		compiled.run();
+		std::cout << "jit: " << CORPUS[i].name << " state "
+				<< (same(interp, compiled) ? "identical" : "DIFFERS") << std::endl;
+	}
+
+	// run loop program on both engines
+	load(interp, LOOP, sizeof(LOOP) / sizeof(word));
+	load(compiled, LOOP, sizeof(LOOP) / sizeof(word));
+	double interp_time = timed_run(interp);
+	double compiled_time = timed_run(compiled);
+	std::cout << "jit: interp " << (count / interp_time) / 1e6 << " Minst/s, jit "
+			<< (count / compiled_time) / 1e6 << " Minst/s" << std::endl;
+}
+
+/*
+ * Benchmark the pre-decoded cache against the interpreter, validating the corpus
+ * and counting superinstructions
+ */
+static void bench_cached(void) {
+	dcpu interp(dcpu::INTERP), cached(dcpu::CACHED);
+	size_t count = (size_t) OUTER * ((5 * (size_t) INNER) + 3);
+
+	// validate every program in the corpus
+	for(size_t i = 0; i < sizeof(CORPUS) / sizeof(CORPUS[0]); ++i) {
+		load(interp, CORPUS[i].prog, CORPUS[i].len);
+		load(cached, CORPUS[i].prog, CORPUS[i].len);
+		interp.run();
+		cached.run();
+		std::cout << "cached: " << CORPUS[i].name << " state "
+				<< (same(interp, cached) ? "identical" : "DIFFERS") << std::endl;
+	}
+
+	std::cout << "cached: fused if-jump " << cached.fused(decode::F_IF_JUMP)
+			<< ", push " << cached.fused(decode::F_PUSH)
+			<< ", pop " << cached.fused(decode::F_POP)
+			<< ", arith-if " << cached.fused(decode::F_ARITH_IF)
+			<< ", jsr " << cached.fused(decode::F_JSR) << std::endl;
+
+	// run loop program on both engines
+	load(interp, LOOP, sizeof(LOOP) / sizeof(word));
+	load(cached, LOOP, sizeof(LOOP) / sizeof(word));
+	double interp_time = timed_run(interp);
+	double cached_time = timed_run(cached);
+	std::cout << "cached: loop interp " << (count / interp_time) / 1e6 << " Minst/s, cached "
+			<< (count / cached_time) / 1e6 << " Minst/s" << std::endl;
+
+	// run stack program on both engines
+	count = 1 + (11 * (size_t) STACK_COUNT);
+	interp_time = 0.0;
+	cached_time = 0.0;
+	for(size_t i = 0; i < 0x40; ++i) {
+		load(interp, STACK, sizeof(STACK) / sizeof(word));
+		load(cached, STACK, sizeof(STACK) / sizeof(word));
+		interp_time += timed_run(interp);
+		cached_time += timed_run(cached);
+	}
+	std::cout << "cached: stack interp " << ((count * 0x40) / interp_time) / 1e6 << " Minst/s, cached "
+			<< ((count * 0x40) / cached_time) / 1e6 << " Minst/s" << std::endl;
+}
+
+/*
+ * Random program count, length & cycle budget (seeded, so every run
+ * checks the same programs)
+ */
+static const size_t RANDOM_COUNT = 2000;
+static const size_t RANDOM_LEN = 0x20;
+static const size_t RANDOM_BUDGET = 0x10000;
+
+/*
+ * Return the next pseudo-random word (64-bit LCG)
+ */
+static word random_word(uint64_t &state) {
+	state = (state * 6364136223846793005ULL) + 1442695040888963407ULL;
+	return (word) (state >> 33);
+}
+
+/*
+ * Return a random command (biased towards register operands and away
+ * from writes to literals & PC, so most programs run a while)
+ */
+static word random_command(uint64_t &state) {
+	for(;;) {
+		word op = random_word(state);
+		word code = op & 0xF;
+		word a = (op >> dcpu::B_OP_LEN) & 0x3F;
+		word b = (op >> (dcpu::B_OP_LEN + dcpu::INPUT_LEN)) & 0x3F;
+
+		// non-basic commands (a few invalid ones halt the program)
+		if(code == dcpu::NB) {
+			if(random_word(state) % 4)
+				continue;
+			if(a == dcpu::JSR && b != dcpu::PC_VAL)
+				return op;
+			if(!(random_word(state) % 4))
+				return op;
+			continue;
+		}
+
+		// basic commands
+		if(a >= dcpu::L_LIT
+				|| (a == dcpu::PC_VAL && (random_word(state) % 4))
+				|| (b == dcpu::PC_VAL && (random_word(state) % 2))
+				|| (a > dcpu::H_REG && (random_word(state) % 2))
+				|| (b > dcpu::H_REG && b < dcpu::L_LIT && (random_word(state) % 2)))
+			continue;
+		return op;
+	}
+}
+
+/*
+ * Check every engine against the interpreter on seeded random programs
+ * (programs stopped by the budget or an idle loop are not compared, as
+ * engines may stop them at different points)
+ */
+static void bench_engines(void) {
+	dcpu interp(dcpu::INTERP), threaded(dcpu::THREADED), compiled(dcpu::JIT), cached(dcpu::CACHED);
+	dcpu *engines[] = { &threaded, &compiled, &cached };
+	const char *names[] = { "threaded", "jit", "cached" };
+	size_t compared = 0, stopped = 0, differs[] = { 0, 0, 0 };
+	word prog[RANDOM_LEN], seed[dcpu::M_REG_COUNT];
+
+	for(size_t i = 0; i < RANDOM_COUNT; ++i) {
+		uint64_t state = i + 1;
+		word reason[4];
+
+		// generate a program & register seeds
+		for(size_t j = 0; j < RANDOM_LEN; ++j)
+			prog[j] = random_command(state);
+		for(word j = 0; j < dcpu::M_REG_COUNT; ++j)
+			seed[j] = (random_word(state) % 2) ? random_word(state) : random_word(state) % RANDOM_LEN;
+
+		// run it on every engine
+		load(interp, prog, RANDOM_LEN);
+		for(word j = 0; j < dcpu::M_REG_COUNT; ++j)
+			interp.m_register(j).set(seed[j]);
+		reason[0] = interp.run(RANDOM_BUDGET);
+		for(size_t e = 0; e < 3; ++e) {
+			load(*engines[e], prog, RANDOM_LEN);
+			for(word j = 0; j < dcpu::M_REG_COUNT; ++j)
+				engines[e]->m_register(j).set(seed[j]);
+			reason[e + 1] = engines[e]->run(RANDOM_BUDGET);
+		}
+
+		// compare engines that all halted
+		if(std::count(reason, reason + 4, dcpu::BUDGET)
+				|| std::count(reason, reason + 4, dcpu::IDLE)) {
+			++stopped;
+			continue;
+		}
+		++compared;
+		for(size_t e = 0; e < 3; ++e)
+			if(reason[e + 1] != reason[0] || !same(interp, *engines[e]))
+				++differs[e];
+	}
+	std::cout << "engines: " << RANDOM_COUNT << " random programs, " << compared << " compared, "
+			<< stopped << " stopped by budget or idle" << std::endl;
+	for(size_t e = 0; e < 3; ++e)
+		std::cout << "engines: " << names[e] << " state "
+				<< (differs[e] ? "DIFFERS" : "identical") << " (" << differs[e] << " differ)" << std::endl;
+}
+
+/*
+ * Benchmark batch scaling across 1, 2, 4 ... N threads on the arithmetic program
+ */
+static void bench_batch(void) {
+	const size_t jobs = 0x100;
+	size_t cores = std::thread::hardware_concurrency();
+	std::vector<word> image(ARITH, ARITH + (sizeof(ARITH) / sizeof(word)));
+	double base = 0.0;
+
+	// run the same jobs at each thread count
+	if(!cores)
+		cores = 1;
+	for(size_t threads = 1;; threads *= 2) {
+		if(threads > cores)
+			threads = cores;
+		batch runner(threads);
+		for(size_t i = 0; i < jobs; ++i)
+			runner.add(image);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		runner.run();
+		double time = elapsed(start);
+		if(threads == 1)
+			base = time;
+		std::cout << "batch: " << threads << " threads, " << (jobs / time) << " jobs/s, speedup "
+				<< (base / time) << std::endl;
+		if(threads == cores)
+			break;
+	}
+}
+
+/*
+ * Benchmark skipping commands after failed conditionals on the branch program
+ */
+static void bench_branch(void) {
+	dcpu interp(dcpu::INTERP), threaded(dcpu::THREADED);
+	size_t count = (size_t) BRANCH_COUNT * 5, runs = 0x40;
+	double interp_time = 0.0, threaded_time = 0.0;
+
+	// run branch program on both engines
+	for(size_t i = 0; i < runs; ++i) {
+		load(interp, BRANCH, sizeof(BRANCH) / sizeof(word));
+		load(threaded, BRANCH, sizeof(BRANCH) / sizeof(word));
+		interp_time += timed_run(interp);
+		threaded_time += timed_run(threaded);
+	}
+	std::cout << "branch: interp " << ((count * runs) / interp_time) / 1e6 << " Minst/s, threaded "
+			<< ((count * runs) / threaded_time) / 1e6 << " Minst/s, state "
+			<< (same(interp, threaded) ? "identical" : "DIFFERS") << std::endl;
+}
+
+/*
+ * Benchmark running the loop program in budgeted slices on each engine
+ * against a free run, then stepping it between breakpoints
+ */
+static void bench_budget(void) {
+	const size_t quantum = 0x1000;
+	const struct {
+		const char *name;
+		word engine;
+	} engines[] = {
+		{ "interp", dcpu::INTERP },
+		{ "threaded", dcpu::THREADED },
+		{ "jit", dcpu::JIT },
+		{ "cached", dcpu::CACHED },
+	};
+	size_t count = (size_t) OUTER * ((5 * (size_t) INNER) + 3);
+
+	// run each engine freely and in slices
+	for(size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); ++i) {
+		dcpu whole(engines[i].engine), sliced(engines[i].engine);
+		size_t slices = 0;
+		load(whole, LOOP, sizeof(LOOP) / sizeof(word));
+		load(sliced, LOOP, sizeof(LOOP) / sizeof(word));
+		double free_time = timed_run(whole);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		while(sliced.run(quantum) == dcpu::BUDGET)
+			++slices;
+		double sliced_time = elapsed(start);
+		std::cout << "budget: " << engines[i].name << " free " << (count / free_time) / 1e6
+				<< " Minst/s, " << slices << " slices " << (count / sliced_time) / 1e6
+				<< " Minst/s, state " << (same(whole, sliced) ? "identical" : "DIFFERS") << std::endl;
+	}
+
+	// straight-line code (memory filled with ADD A, 1 / ADD B, A) stops
+	// near the budget on each engine
+	std::vector<word> line(COUNT);
+	for(dword i = 0; i < COUNT; ++i)
+		line[i] = (i % 2) ? 0x0012 : 0x8402;
+	for(size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); ++i) {
+		dcpu straight(engines[i].engine);
+		load(straight, &line[0], line.size());
+		word reason = straight.run(quantum);
+		std::cout << "budget: " << engines[i].name << " straight-line "
+				<< ((reason == dcpu::BUDGET && straight.cycles() < 2 * quantum) ? "stopped" : "DID NOT STOP")
+				<< " at " << straight.cycles() << " cycles (budget " << quantum << ")" << std::endl;
+	}
+
+	// stop at the top of each outer iteration
+	dcpu cpu;
+	size_t hits = 0;
+	load(cpu, LOOP, sizeof(LOOP) / sizeof(word));
+	cpu.set_breakpoint(0x02);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while(cpu.run(SIZE_MAX) == dcpu::BREAKPOINT)
+		++hits;
+	double time = elapsed(start);
+	std::cout << "budget: breakpoint " << hits << " hits (expected " << OUTER << "), "
+			<< (count / time) / 1e6 << " Minst/s" << std::endl;
+}
+
+/*
+ * Benchmark forking children from a warmed-up cpu by copy and by snapshot
+ */
+static void bench_fork(void) {
+	const size_t children = 0x1000, warm = 0x10000, slice = 0x100;
+	dcpu parent, copied, restored;
+	double copy_time = 0.0, restore_time = 0.0;
+	bool identical = true;
+
+	// warm up the arithmetic program (fills memory from 0x1000)
+	load(parent, ARITH, sizeof(ARITH) / sizeof(word));
+	parent.run(warm);
+	snapshot start(parent);
+
+	// run each child for a slice past the parent
+	for(size_t i = 0; i < children; ++i) {
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		dcpu child(parent);
+		child.run(slice);
+		copy_time += elapsed(begin);
+		if(!i)
+			copied = child;
+		begin = std::chrono::steady_clock::now();
+		start.restore(restored);
+		restored.run(slice);
+		restore_time += elapsed(begin);
+	}
+	identical = same(copied, restored);
+	std::cout << "fork: " << start.pages() << " pages, state " << (identical ? "identical" : "DIFFERS")
+			<< std::endl;
+	std::cout << "fork: copy " << (children / copy_time) << " children/s, snapshot "
+			<< (children / restore_time) << " children/s" << std::endl;
+}
+
+/*
+ * Benchmark pacing the loop program to fixed clock rates, reporting host
+ * cpu use and wake-up jitter
+ */
+static void bench_pace(void) {
+	const size_t rates[] = { pacer::FREQUENCY, 10 * pacer::FREQUENCY, 100 * pacer::FREQUENCY };
+	const double seconds = 0.5;
+
+	for(size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); ++i) {
+		dcpu cpu;
+		pacer clock(cpu, rates[i]);
+		load(cpu, LOOP, sizeof(LOOP) / sizeof(word));
+		std::clock_t used = std::clock();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		clock.run(rates[i] * seconds);
+		double time = elapsed(start);
+		used = std::clock() - used;
+		const pacer::stats &info = clock.statistics();
+		std::cout << "pace: " << rates[i] << " Hz, " << (cpu.cycles() / time) << " Hz run, cpu "
+				<< (((double) used / CLOCKS_PER_SEC) / time) * 100.0 << "%, jitter "
+				<< (info.jitter_total / info.periods) * 1e6 << " us avg, " << info.jitter_max * 1e6
+				<< " us max, " << info.late << " late" << std::endl;
+	}
+}
+
+/*
+ * Benchmark profiling the loop program against an unprofiled interpreter run
+ */
+static void bench_profile(void) {
+	dcpu plain, profiled;
+	profiler prof;
+	size_t count = (size_t) OUTER * ((5 * (size_t) INNER) + 3);
+
+	// run loop program with and without the profiler
+	load(plain, LOOP, sizeof(LOOP) / sizeof(word));
+	load(profiled, LOOP, sizeof(LOOP) / sizeof(word));
+	double plain_time = timed_run(plain);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	profiled.run(SIZE_MAX, prof);
+	double profiled_time = elapsed(start);
+	profiled.halt();
+	std::cout << "profile: interp " << (count / plain_time) / 1e6 << " Minst/s, profiled "
+			<< (count / profiled_time) / 1e6 << " Minst/s, cycles "
+			<< (prof.total() == profiled.cycles() ? "match" : "DIFFER") << ", state "
+			<< (same(plain, profiled) ? "identical" : "DIFFERS") << std::endl;
+	std::cout << prof.report(profiled.memory(), 5);
+}
+
+/*
+ * Benchmark building control flow graphs of the corpus programs and of a
+ * full memory image of chained chunks
+ *
+ * 	chunk:	IFN A, k
+ * 		SET PC, chunk
+ * 		ADD B, A
+ * 		JSR chunk
+ * 		SUB C, 1
+ * 		XOR A, B
+ */
+static void bench_cfg(void) {
+	const size_t reps = 0x10;
+	const word chunk = 0x08;
+	std::vector<word> image;
+	mem128 mem;
+	cfg graph;
+	double best = 0.0;
+	dword state = 0x2545F491;
+
+	// graph each corpus program
+	for(size_t i = 0; i < sizeof(CORPUS) / sizeof(CORPUS[0]); ++i) {
+		mem.clear();
+		mem.set(LOW, CORPUS[i].len, CORPUS[i].prog);
+		graph.build(mem, LOW, LOW, CORPUS[i].len);
+		std::cout << "cfg: " << CORPUS[i].name << " " << graph.blocks().size() << " blocks, "
+				<< graph.edges().size() << " edges" << std::endl;
+	}
+
+	// fill memory with chunks branching & calling to pseudo-random chunks
+	for(dword i = 0; i < COUNT; i += chunk) {
+		word first, second;
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		first = (state % (COUNT / chunk)) * chunk;
+		second = ((state >> 16) % (COUNT / chunk)) * chunk;
+		word words[] = { (word) (((0x20 + (i / chunk) % dcpu::LIT_COUNT) << 10) | 0x000D), 0x7DC1, first,
+				0x0012, 0x7C10, second, 0x8423, 0x040B };
+		image.insert(image.end(), words, words + chunk);
+	}
+	mem.set(LOW, COUNT, &image[0]);
+
+	// build the full image graph, keeping the best time
+	for(size_t i = 0; i < reps; ++i) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		graph.build(mem);
+		double time = elapsed(start);
+		best = (!i || time < best) ? time : best;
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	size_t text = graph.dump(mem).size();
+	double dump_time = elapsed(start);
+	start = std::chrono::steady_clock::now();
+	size_t dot = graph.dot(mem).size();
+	double dot_time = elapsed(start);
+	std::cout << "cfg: image " << graph.blocks().size() << " blocks, " << graph.edges().size()
+			<< " edges, build " << best * 1e3 << " ms, text " << text / 1024 << " KB in " << dump_time * 1e3
+			<< " ms, dot " << dot / 1024 << " KB in " << dot_time * 1e3 << " ms" << std::endl;
+}
+
+/*
+ * Benchmark resetting, comparing and copying memory after short runs
+ */
+static void bench_reset(void) {
+	const size_t runs = 0x1000, slice = 0x100;
+	dcpu cpu, other;
+	double sweep_time = 0.0, dirty_time = 0.0, compare_time = 0.0, copy_time = 0.0;
+	bool identical = true;
+
+	for(size_t i = 0; i < runs; ++i) {
+
+		// full sweep
+		load(cpu, ARITH, sizeof(ARITH) / sizeof(word));
+		cpu.run(slice);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		cpu.memory().fill_all(LOW);
+		sweep_time += elapsed(start);
+
+		// dirty pages only
+		load(cpu, ARITH, sizeof(ARITH) / sizeof(word));
+		cpu.run(slice);
+		start = std::chrono::steady_clock::now();
+		cpu.memory().clear();
+		dirty_time += elapsed(start);
+
+		// copy over the previous run, then compare
+		load(cpu, ARITH, sizeof(ARITH) / sizeof(word));
+		cpu.run(slice + i);
+		start = std::chrono::steady_clock::now();
+		other = cpu;
+		copy_time += elapsed(start);
+		start = std::chrono::steady_clock::now();
+		identical = identical && cpu.memory() == other.memory();
+		compare_time += elapsed(start);
+		identical = identical && same(cpu, other);
+	}
+	std::cout << "reset: copy & compare " << (identical ? "identical" : "DIFFERS") << std::endl;
+	std::cout << "reset: sweep " << (runs / sweep_time) << " resets/s, dirty " << (runs / dirty_time)
+			<< " resets/s" << std::endl;
+	std::cout << "reset: compare " << (runs / compare_time) << " compares/s, copy " << (runs / copy_time)
+			<< " copies/s" << std::endl;
+}
+
+/*
+ * Benchmark loading a full memory image a byte pair at a time and mapped
+ */
+static void bench_load(void) {
+	const size_t loads = 0x40;
+	std::string path = "dcpu_bench.bin";
+	std::vector<halfword> bytes(COUNT * sizeof(word));
+	dcpu streamed, mapped;
+	double stream_time = 0.0, map_time = 0.0;
+
+	// write a big endian image filling memory
+	for(dword i = 0; i < COUNT; ++i) {
+		bytes[i * 2] = (halfword) (i >> 8);
+		bytes[(i * 2) + 1] = (halfword) (i * 0x1F);
+	}
+	std::ofstream out(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	out.write((const char *) &bytes[0], bytes.size());
+	out.close();
+
+	for(size_t i = 0; i < loads; ++i) {
+
+		// read a word at a time, then set each word
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+		std::vector<word> prog;
+		halfword high, low;
+		while(file.good()) {
+			file.read((char *) &high, sizeof(halfword));
+			file.read((char *) &low, sizeof(halfword));
+			prog.push_back((word) ((high << 8) | low));
+		}
+		prog.erase(prog.end() - 1);
+		for(size_t j = 0; j < prog.size(); ++j)
+			streamed.memory().set(j, prog.at(j));
+		stream_time += elapsed(start);
+
+		// map and swap in bulk
+		start = std::chrono::steady_clock::now();
+		loader::load(path, mapped.memory());
+		map_time += elapsed(start);
+	}
+	std::remove(path.c_str());
+	std::cout << "load: state " << (same(streamed, mapped) ? "identical" : "DIFFERS") << std::endl;
+	std::cout << "load: stream " << (loads / stream_time) << " images/s, mapped " << (loads / map_time)
+			<< " images/s" << std::endl;
+}
+
+/*
+ * Benchmark dumping full memory a byte at a time and through one write
+ */
+static void bench_dump(void) {
+	const size_t dumps = 0x40;
+	std::string path = "dcpu_bench.bin";
+	std::vector<char> streamed, written;
+	double stream_time = 0.0, write_time = 0.0;
+	dcpu cpu;
+
+	for(dword i = 0; i < COUNT; ++i)
+		cpu.memory().set(i, (word) (i * 0x9E37));
+	for(size_t i = 0; i < dumps; ++i) {
+
+		// two single byte writes per word
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::ofstream file(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		for(dword j = 0; j < COUNT; ++j) {
+			const char *bytes = reinterpret_cast<const char *>(&cpu.memory().at(j));
+			file.write(&bytes[1], sizeof(halfword));
+			file.write(&bytes[0], sizeof(halfword));
+		}
+		file.close();
+		stream_time += elapsed(start);
+		if(!i) {
+			std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+			streamed.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		}
+
+		// swapped & written in one call
+		start = std::chrono::steady_clock::now();
+		cpu.memory().dump_to_file(LOW, COUNT, path);
+		write_time += elapsed(start);
+	}
+	std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+	written.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	std::remove(path.c_str());
+	std::cout << "dump: file " << (streamed == written ? "identical" : "DIFFERS") << std::endl;
+	std::cout << "dump: stream " << (dumps / stream_time) << " dumps/s, single write " << (dumps / write_time)
+			<< " dumps/s" << std::endl;
+}
+
+/*
+ * Format memory through a string stream (one manipulator chain per word)
+ */
+static std::string dump_stream(mem128 &mem, word offset, dword range) {
+	std::stringstream ss;
+
+	for(dword i = 0; i < range; ++i) {
+		if(!(i % 16)) {
+			if(i)
+				ss << std::endl;
+			ss << "0x" << std::hex << std::uppercase << std::setfill('0') << std::setw(4) << (offset + i) << " | ";
+		}
+		ss << std::hex << std::uppercase << std::setfill('0') << std::setw(4) << (unsigned) mem.at(offset + i) << " ";
+	}
+	return ss.str();
+}
+
+/*
+ * Benchmark formatting full memory through a string stream, the hex
+ * table and the hex table collapsing repeated rows
+ */
+static void bench_hex(void) {
+	const size_t dumps = 0x10;
+	double stream_time = 0.0, table_time = 0.0, collapse_time = 0.0;
+	size_t collapsed = 0;
+	bool identical = true;
+	dcpu cpu;
+
+	// sparse memory (a program and a little data)
+	load(cpu, ARITH, sizeof(ARITH) / sizeof(word));
+	cpu.run(0x1000);
+	for(size_t i = 0; i < dumps; ++i) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::string streamed = dump_stream(cpu.memory(), LOW, COUNT);
+		stream_time += elapsed(start);
+		start = std::chrono::steady_clock::now();
+		std::string table = cpu.memory().dump_all();
+		table_time += elapsed(start);
+		start = std::chrono::steady_clock::now();
+		collapsed = cpu.memory().dump_all(true).size();
+		collapse_time += elapsed(start);
+		identical = identical && streamed == table;
+	}
+	std::cout << "hex: text " << (identical ? "identical" : "DIFFERS") << ", collapsed to " << collapsed
+			<< " characters" << std::endl;
+	std::cout << "hex: stream " << (dumps / stream_time) << " dumps/s, table " << (dumps / table_time)
+			<< " dumps/s, collapsed " << (dumps / collapse_time) << " dumps/s" << std::endl;
+}
+
+/*
+ * Benchmark stopping at idle loops on each engine, then parking idle
+ * guests in the scheduler and pacer
+ */
+static void bench_idle(void) {
+	const struct {
+		const char *name;
+		word engine;
+	} engines[] = {
+		{ "interp", dcpu::INTERP },
+		{ "threaded", dcpu::THREADED },
+		{ "jit", dcpu::JIT },
+		{ "cached", dcpu::CACHED },
+	};
+	const struct {
+		const char *name;
+		const word *prog;
+		size_t len;
+	} progs[] = {
+		{ "halt", HALT, sizeof(HALT) / sizeof(word) },
+		{ "wait", WAIT, sizeof(WAIT) / sizeof(word) },
+	};
+	const size_t guests = 0x100;
+	std::vector<word> image(WAIT, WAIT + (sizeof(WAIT) / sizeof(word)));
+	scheduler host;
+	size_t parked = 0;
+
+	// run each idle program until it stops on each engine
+	for(size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); ++i)
+		for(size_t j = 0; j < sizeof(progs) / sizeof(progs[0]); ++j) {
+			dcpu cpu(engines[i].engine);
+			load(cpu, progs[j].prog, progs[j].len);
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			word reason = cpu.run(SIZE_MAX);
+			double time = elapsed(start);
+			std::cout << "idle: " << engines[i].name << " " << progs[j].name << " "
+					<< ((reason == dcpu::IDLE) ? "stopped" : "DID NOT STOP") << " at PC 0x" << std::hex
+					<< cpu.s_register(dcpu::PC).get() << std::dec << ", " << cpu.cycles() << " cycles, "
+					<< time * 1e6 << " us" << std::endl;
+		}
+
+	// lanes running in lockstep halt at the idle loop
+	lockstep group;
+	group.load(std::vector<word>(HALT, HALT + (sizeof(HALT) / sizeof(word))));
+	std::chrono::steady_clock::time_point grouped = std::chrono::steady_clock::now();
+	group.run();
+	double group_time = elapsed(grouped);
+	std::cout << "idle: lockstep halted at PC 0x"
+			<< std::hex << group.lane(0).s_register(dcpu::PC).get() << std::dec << ", "
+			<< group.lane(0).cycles() << " cycles, " << group_time * 1e6 << " us" << std::endl;
+
+	// lanes left in lockstep halt at the idle loop once another lane splits off
+	bool halted = true;
+	group.load(std::vector<word>(DIVERGE, DIVERGE + (sizeof(DIVERGE) / sizeof(word))));
+	group.lane(lockstep::LANES - 1).m_register(dcpu::B).set(1);
+	group.run();
+	for(word i = 0; i < lockstep::LANES; ++i)
+		halted = halted && !group.lane(i).is_running();
+	std::cout << "idle: lockstep diverged " << (halted ? "halted" : "DID NOT HALT") << " at PC 0x"
+			<< std::hex << group.lane(0).s_register(dcpu::PC).get() << std::dec << ", "
+			<< group.diverged() << " lanes diverged" << std::endl;
+
+	// idle guests are parked, and run again once woken
+	for(size_t i = 0; i < guests; ++i)
+		host.add(image);
+	size_t rounds = host.run();
+	for(size_t i = 0; i < guests; ++i)
+		parked += host.state(i) == scheduler::PARKED;
+	host.at(0).m_register(dcpu::A).set(1);
+	host.wake(0);
+	host.run();
+	std::cout << "idle: scheduler " << parked << " of " << guests << " guests parked after "
+			<< rounds << " rounds, woken guest " << ((host.state(0) == scheduler::HALTED) ? "halted" : "DID NOT HALT")
+			<< std::endl;
+
+	// a paced idle cpu sleeps instead of spinning, and runs again once woken
+	dcpu cpu;
+	pacer clock(cpu);
+	load(cpu, WAIT, sizeof(WAIT) / sizeof(word));
+	std::thread waker([&]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+		cpu.m_register(dcpu::A).set(1);
+		clock.wake();
+	});
+	std::clock_t used = std::clock();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	word reason = clock.run(pacer::FREQUENCY);
+	double time = elapsed(start);
+	used = std::clock() - used;
+	waker.join();
+	std::cout << "idle: pace " << ((reason == dcpu::INVALID) ? "halted" : "DID NOT HALT") << " after "
+			<< time * 1e3 << " ms, parked " << clock.statistics().idle * 1e3 << " ms, cpu "
+			<< (((double) used / CLOCKS_PER_SEC) / time) * 100.0 << "%" << std::endl;
+}
+
+/*
+ * Benchmark recording the arithmetic program at several checkpoint
+ * intervals, reporting memory held and seek latency, and checking seeks
+ * and reverse steps against a cpu run forward from the start
+ */
+static void bench_replay(void) {
+	const size_t intervals[] = { 0x1000, 0x8000, 0x40000 }, seeks = 0x40;
+	dcpu plain;
+
+	load(plain, ARITH, sizeof(ARITH) / sizeof(word));
+	double plain_time = timed_run(plain);
+	for(size_t i = 0; i < sizeof(intervals) / sizeof(intervals[0]); ++i) {
+		dcpu cpu, ref;
+		size_t target = 0, lcg = 1;
+		bool identical = true;
+
+		// record the whole run
+		load(cpu, ARITH, sizeof(ARITH) / sizeof(word));
+		replay history(cpu, intervals[i]);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		history.run();
+		double record_time = elapsed(start);
+
+		// seek to random cycles
+		start = std::chrono::steady_clock::now();
+		for(size_t j = 0; j < seeks; ++j) {
+			lcg = (lcg * 6364136223846793005ULL) + 1442695040888963407ULL;
+			target = (lcg >> 33) % plain.cycles();
+			history.seek(target);
+		}
+		double seek_time = elapsed(start) / seeks;
+
+		// check the last seek and a reverse step against a forward run
+		load(ref, ARITH, sizeof(ARITH) / sizeof(word));
+		while(ref.cycles() < target)
+			ref.step();
+		identical = same(cpu, ref) && history.reverse_step() && (cpu.cycles() < target);
+		cpu.step();
+		identical = identical && same(cpu, ref);
+		std::cout << "replay: interval " << intervals[i] << ", " << history.checkpoints() << " checkpoints, "
+				<< (history.memory() / 1024) << " KB, record " << (record_time / plain_time) << "x, seek "
+				<< (seek_time * 1e6) << " us, state " << (identical ? "identical" : "DIFFERS") << std::endl;
+	}
+}
+
+/*
+ * Benchmark sampling the call program against an unsampled run, folding
+ * the samples into stacks
+ */
+static void bench_sample(void) {
+	std::string path = "dcpu_bench.bin";
+	std::stringstream folded;
+	dcpu plain, sampled;
+	size_t samples, lost;
+
+	// run call program with and without sampling
+	load(plain, CALLS, sizeof(CALLS) / sizeof(word));
+	load(sampled, CALLS, sizeof(CALLS) / sizeof(word));
+	double plain_time = timed_run(plain);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	{
+		sampler probe(path, 0x100);
+		probe.run(sampled);
+		samples = probe.samples();
+		lost = probe.dropped();
+	}
+	double sampled_time = elapsed(start);
+	sampled.halt();
+	std::cout << "sample: plain " << (plain.cycles() / plain_time) / 1e6 << " Mcycle/s, sampled "
+			<< (sampled.cycles() / sampled_time) / 1e6 << " Mcycle/s, " << samples << " samples, "
+			<< lost << " dropped, state " << (same(plain, sampled) ? "identical" : "DIFFERS") << std::endl;
+
+	// print folded stacks
+	if(!sampler::fold(path, folded))
+		std::cout << "sample: fold FAILED" << std::endl;
+	std::cout << folded.str();
+	std::remove(path.c_str());
+}
+
+/*
+ * Benchmark scheduling guests on the loop program, parking every fourth
+ * guest on odd rounds, reporting fairness and quantum delivery delay
+ */
+static void bench_scheduler(void) {
+	const size_t guests = 0x400, rounds = 0x40;
+	std::vector<word> image(LOOP, LOOP + (sizeof(LOOP) / sizeof(word)));
+	std::vector<double> waits;
+	scheduler host;
+	size_t total = 0;
+	double sum = 0.0, squares = 0.0;
+	size_t count = 0;
+
+	// add guests
+	for(size_t i = 0; i < guests; ++i)
+		host.add(image);
+
+	// run rounds, collecting each guest's delivery delay
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < rounds; ++i) {
+		for(size_t j = 0; j < guests; j += 4)
+			if(i % 2)
+				host.park(j);
+			else
+				host.wake(j);
+		host.round();
+		for(size_t j = 0; j < guests; ++j)
+			if(host.state(j) == scheduler::READY)
+				waits.push_back(host.accounting(j).wait);
+	}
+	double time = elapsed(start);
+
+	// fairness (Jain's index) over guests that were never parked
+	for(size_t i = 0; i < guests; ++i) {
+		const scheduler::account &acct = host.accounting(i);
+		total += acct.cycle;
+		if(i % 4) {
+			sum += acct.cycle;
+			squares += (double) acct.cycle * acct.cycle;
+			++count;
+		}
+	}
+	std::sort(waits.begin(), waits.end());
+	std::cout << "scheduler: " << guests << " guests, " << host.threads() << " threads, "
+			<< (rounds / time) << " rounds/s, " << (total / time) / 1e6 << " Mcycle/s" << std::endl;
+	std::cout << "scheduler: fairness " << ((sum * sum) / (count * squares)) << ", delay p50 "
+			<< waits[waits.size() / 2] * 1e3 << " ms, p99 " << waits[(waits.size() * 99) / 100] * 1e3
+			<< " ms, max " << waits.back() * 1e3 << " ms" << std::endl;
+}
+
+/*
+ * Benchmark tracing the loop program against an untraced interpreter run,
+ * then decode the trace
+ */
+static void bench_trace(void) {
+	const size_t budget = 0x100000;
+	std::string path = "dcpu_bench.bin";
+	std::stringstream text;
+	dcpu plain, traced;
+	size_t records, stalls;
+
+	// run loop program with and without tracing
+	load(plain, LOOP, sizeof(LOOP) / sizeof(word));
+	load(traced, LOOP, sizeof(LOOP) / sizeof(word));
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	plain.run(budget);
+	double plain_time = elapsed(start);
+	start = std::chrono::steady_clock::now();
+	{
+		tracer trace(traced, path);
+		traced.run(budget, trace);
+		records = trace.records();
+		stalls = trace.stalls();
+	}
+	double traced_time = elapsed(start);
+	std::ifstream in(path.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+	size_t size = in.tellg();
+	std::cout << "trace: plain " << (plain.cycles() / plain_time) / 1e6 << " Mcycle/s, traced "
+			<< (traced.cycles() / traced_time) / 1e6 << " Mcycle/s, slowdown " << (traced_time / plain_time)
+			<< "x, " << ((double) size / records) << " bytes/record, " << stalls << " stalls, state "
+			<< (same(plain, traced) ? "identical" : "DIFFERS") << std::endl;
+
+	// the trace must fill more than one buffer to use the spare ones
+	std::cout << "trace: " << ((size + tracer::CHUNK_LEN - 1) / tracer::CHUNK_LEN) << " buffers"
+			<< ((size > tracer::CHUNK_LEN) ? "" : " (DID NOT SPAN BUFFERS)") << std::endl;
+
+	// decode every record, printing the first few
+	if(!tracer::decode(path, text))
+		std::cout << "trace: decode FAILED" << std::endl;
+	std::string lines = text.str();
+	size_t end = 0;
+	for(size_t i = 0; i < 8 && end < lines.size(); ++i)
+		end = lines.find('\n', end) + 1;
+	std::cout << "trace: " << std::count(lines.begin(), lines.end(), '\n') << " of " << records
+			<< " records decoded" << std::endl << lines.substr(0, end);
+	std::remove(path.c_str());
+}
+
+/*
+ * Seed a cpu's main registers for a given lane
+ */
+static void seed(dcpu &cpu, word lane) {
+	for(word i = 0; i < dcpu::M_REG_COUNT; ++i)
+		cpu.m_register(i).set(lane * (0x1111 + (i * 0x0F0F)));
+}
+
+/*
+ * Benchmark lockstep lanes against scalar runs, validating the corpus
+ */
+static void bench_lockstep(void) {
+	lockstep lanes;
+	dcpu scalar;
+	size_t count = lockstep::LANES * (1 + (8 * (size_t) HASH_COUNT));
+	double scalar_time = 0.0;
+
+	// validate every program in the corpus with seeded lanes
+	for(size_t i = 0; i < sizeof(CORPUS) / sizeof(CORPUS[0]); ++i) {
+		bool identical = true;
+		lanes.load(std::vector<word>(CORPUS[i].prog, CORPUS[i].prog + CORPUS[i].len));
+		for(word j = 0; j < lockstep::LANES; ++j)
+			seed(lanes.lane(j), j);
+		lanes.run();
+		for(word j = 0; j < lockstep::LANES; ++j) {
+			load(scalar, CORPUS[i].prog, CORPUS[i].len);
+			seed(scalar, j);
+			scalar.run();
+			identical = identical && same(scalar, lanes.lane(j));
+		}
+		std::cout << "lockstep: " << CORPUS[i].name << " state " << (identical ? "identical" : "DIFFERS")
+				<< ", " << lanes.diverged() << " lanes diverged" << std::endl;
+	}
+
+	// lanes starting at different PCs run their own commands (the last
+	// four lanes skip the hash program's setup)
+	bool identical = true;
+	lanes.load(std::vector<word>(HASH, HASH + (sizeof(HASH) / sizeof(word))));
+	for(word j = 0; j < lockstep::LANES; ++j) {
+		seed(lanes.lane(j), j);
+		lanes.lane(j).s_register(dcpu::PC).set((j >= lockstep::LANES - 4) ? 0x03 : 0x00);
+	}
+	lanes.run();
+	for(word j = 0; j < lockstep::LANES; ++j) {
+		load(scalar, HASH, sizeof(HASH) / sizeof(word));
+		seed(scalar, j);
+		scalar.s_register(dcpu::PC).set((j >= lockstep::LANES - 4) ? 0x03 : 0x00);
+		scalar.run();
+		identical = identical && same(scalar, lanes.lane(j));
+	}
+	std::cout << "lockstep: split start state " << (identical ? "identical" : "DIFFERS")
+			<< ", " << lanes.diverged() << " lanes diverged" << std::endl;
+
+	// run hash program on each lane in turn, then in lockstep
+	for(word j = 0; j < lockstep::LANES; ++j) {
+		load(scalar, HASH, sizeof(HASH) / sizeof(word));
+		seed(scalar, j);
+		scalar_time += timed_run(scalar);
+	}
+	lanes.load(std::vector<word>(HASH, HASH + (sizeof(HASH) / sizeof(word))));
+	for(word j = 0; j < lockstep::LANES; ++j)
+		seed(lanes.lane(j), j);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	lanes.run();
+	double lockstep_time = elapsed(start);
+	std::cout << "lockstep: scalar " << (count / scalar_time) / 1e6 << " Minst/s, lockstep "
+			<< (count / lockstep_time) / 1e6 << " Minst/s" << std::endl;
+}
+
+/*
+ * Main
+ */
+int main(int argc, char *argv[]) {
+	std::string name = (argc > 1) ? argv[1] : "";
+
+	// run selected benchmarks
+	if(name.empty() || name == "decode")
+		bench_decode();
+	if(name.empty() || name == "interp")
+		bench_interp();
+	if(name.empty() || name == "threaded")
+		bench_threaded();
+	if(name.empty() || name == "jit")
+		bench_jit();
+	if(name.empty() || name == "cached")
+		bench_cached();
+	if(name.empty() || name == "engines")
+		bench_engines();
+	if(name.empty() || name == "batch")
+		bench_batch();
+	if(name.empty() || name == "branch")
+		bench_branch();
+	if(name.empty() || name == "budget")
+		bench_budget();
+	if(name.empty() || name == "lockstep")
+		bench_lockstep();
+	if(name.empty() || name == "fork")
+		bench_fork();
+	if(name.empty() || name == "reset")
+		bench_reset();
+	if(name.empty() || name == "load")
+		bench_load();
+	if(name.empty() || name == "dump")
+		bench_dump();
+	if(name.empty() || name == "hex")
+		bench_hex();
+	if(name.empty() || name == "scheduler")
+		bench_scheduler();
+	if(name.empty() || name == "pace")
+		bench_pace();
+	if(name.empty() || name == "profile")
+		bench_profile();
+	if(name.empty() || name == "cfg")
+		bench_cfg();
+	if(name.empty() || name == "idle")
+		bench_idle();
+	if(name.empty() || name == "replay")
+		bench_replay();
+	if(name.empty() || name == "sample")
+		bench_sample();
+	if(name.empty() || name == "trace")
+		bench_trace();
+	return 0;
+}
@@ -0,0 +1,75 @@
+/*
+ * bswap.hpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BSWAP_HPP_
+#define BSWAP_HPP_
+
+#include <cstddef>
+#include <cstring>
+#include "types.hpp"
+
+/*
+ * Byte orders
+ */
+enum ORDER { BIG, LITTLE };
+
+/*
+ * Returns if words in a given byte order must be swapped on this host
+ */
+inline bool bswap_needed(word order) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	return order == LITTLE;
+#else
+	return order == BIG;
+#endif
+}
+
+/*
+ * Copy a count of words between unaligned buffers, converting between
+ * host and a given byte order (eight words per vector step)
+ */
+inline void bswap_copy(void *dest, const void *src, size_t count, word order) {
+	typedef word block __attribute__((vector_size(16)));
+	halfword *out = static_cast<halfword *>(dest);
+	const halfword *in = static_cast<const halfword *>(src);
+	size_t i = 0;
+
+	// matching order, plain copy
+	if(!bswap_needed(order)) {
+		std::memcpy(dest, src, count * sizeof(word));
+		return;
+	}
+
+	// swap whole vectors
+	for(; i + (sizeof(block) / sizeof(word)) <= count; i += sizeof(block) / sizeof(word)) {
+		block value;
+		std::memcpy(&value, in + (i * sizeof(word)), sizeof(block));
+		value = (value << 8) | (value >> 8);
+		std::memcpy(out + (i * sizeof(word)), &value, sizeof(block));
+	}
+
+	// swap remaining words
+	for(; i < count; ++i) {
+		halfword high = in[i * sizeof(word)];
+		out[i * sizeof(word)] = in[(i * sizeof(word)) + 1];
+		out[(i * sizeof(word)) + 1] = high;
+	}
+}
+
+#endif
@@ -0,0 +1,411 @@
+/*
+ * cfg.cpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include "cfg.hpp"
+#include "dcpu.hpp"
+#include "decode.hpp"
+#include "disasm.hpp"
+
+/*
+ * Block exit names
+ */
+static const char *EXIT_NAME[] = {
+	"fall", "branch", "jump", "call", "return", "indirect", "invalid", "end",
+};
+
+/*
+ * Edge kind names
+ */
+static const char *EDGE_NAME[] = {
+	"fall", "taken", "skip", "jump", "call",
+};
+
+/*
+ * Control flow graph constructor
+ */
+cfg::cfg(void) :
+	entry(0), offset(0), range(0) {
+	return;
+}
+
+/*
+ * Control flow graph destructor
+ */
+cfg::~cfg(void) {
+	return;
+}
+
+/*
+ * Return blocks in address order
+ */
+const std::vector<cfg::block> &cfg::blocks(void) {
+	return nodes;
+}
+
+/*
+ * Build the graph of commands reached from an entry address,
+ * following control flow within a range of memory
+ *
+ * Commands are found by recursive descent (so data between them is
+ * never decoded), then split into blocks at every branch target and
+ * at every address reached by two different command sequences.
+ */
+void cfg::build(mem128 &mem, word entry, word offset, dword range) {
+	std::vector<word> work;
+	word address, next, target;
+	halfword exit;
+	bool known;
+
+	clear();
+	this->entry = entry;
+	this->offset = offset;
+	this->range = std::min<dword>(range, COUNT - offset);
+	flags.assign(COUNT, 0);
+	if(!inside(entry))
+		return;
+
+	// walk each target until control leaves it, queueing new targets
+	flags[entry] |= A_LEADER;
+	work.push_back(entry);
+	while(!work.empty()) {
+		address = work.back();
+		work.pop_back();
+		for(;;) {
+
+			// a sequence that runs into a command already seen joins it there
+			if(flags[address] & A_SEEN) {
+				flags[address] |= A_LEADER;
+				break;
+			}
+			flags[address] |= A_SEEN;
+			exit = classify(mem, address, next, target, known);
+			if(exit == X_BRANCH) {
+				target = skip(mem, next);
+				if(inside(target)) {
+					flags[target] |= A_LEADER;
+					work.push_back(target);
+				}
+			} else if((exit == X_JUMP
+					|| exit == X_CALL)
+					&& known
+					&& inside(target)) {
+				flags[target] |= A_LEADER;
+				work.push_back(target);
+			}
+
+			// branches & calls continue after the command, in a new block
+			if((exit != X_FALL
+					&& exit != X_BRANCH
+					&& exit != X_CALL)
+					|| !inside(next))
+				break;
+			if(exit != X_FALL)
+				flags[next] |= A_LEADER;
+			address = next;
+		}
+	}
+
+	// split commands into blocks at leaders, in address order
+	for(dword i = 0; i < this->range; ++i) {
+		word start = offset + i;
+		block node;
+
+		if(!(flags[start] & A_LEADER))
+			continue;
+		node.start = address = start;
+		node.length = 0;
+		node.count = 0;
+		node.edge = links.size();
+		for(;;) {
+			exit = classify(mem, address, next, target, known);
+			for(word j = address; j != next; ++j)
+				flags[j] |= A_COVER;
+			node.length += (word) (next - address);
+			++node.count;
+			if(exit == X_FALL) {
+				if(!inside(next)) {
+					exit = X_END;
+					break;
+				}
+				if(flags[next] & A_LEADER) {
+					links.push_back({ start, next, E_FALL });
+					break;
+				}
+				address = next;
+				continue;
+			}
+			if(exit == X_BRANCH) {
+				links.push_back({ start, next, E_TAKEN });
+				links.push_back({ start, skip(mem, next), E_SKIP });
+			} else if(exit == X_JUMP)
+				links.push_back({ start, target, E_JUMP });
+			else if(exit == X_CALL) {
+				if(known)
+					links.push_back({ start, target, E_CALL });
+				links.push_back({ start, next, E_FALL });
+			}
+			break;
+		}
+		node.exit = exit;
+		node.edges = links.size() - node.edge;
+		nodes.push_back(node);
+	}
+}
+
+/*
+ * Classify the command at an address, setting the address after it
+ * and its target (known is cleared if the target is computed at run time)
+ *
+ * Targets are evaluated as the cpu would: PC reads as the address after
+ * the opcode word, and a literal or next word B is constant.
+ */
+halfword cfg::classify(mem128 &mem, word address, word &next, word &target, bool &known) {
+	const decode::op &entry = decode::at(mem.at(address));
+	word pc = address + 1, value;
+
+	next = address + entry.length;
+	target = LOW;
+	known = true;
+
+	// resolve a constant B operand (the A operand for non-basic commands)
+	switch(decode::mode(entry.b)) {
+		case decode::O_LIT:
+			value = entry.b % dcpu::LIT_COUNT;
+			break;
+		case decode::O_NEXT:
+			value = mem.at(pc);
+			break;
+		case decode::O_PC:
+			value = pc;
+			break;
+		default:
+			value = LOW;
+			known = false;
+			break;
+	}
+
+	// JSR (reserved non-basic opcodes halt the cpu)
+	if(!entry.code) {
+		if(entry.a != dcpu::JSR) {
+			next = pc;
+			known = false;
+			return X_INVALID;
+		}
+		target = value;
+		return X_CALL;
+	}
+
+	// only IF* & writes to PC change control flow
+	if(entry.code >= dcpu::IFE) {
+		known = false;
+		return X_BRANCH;
+	}
+	if(entry.a != dcpu::PC_VAL) {
+		known = false;
+		return X_FALL;
+	}
+	if(entry.code == dcpu::SET
+			&& entry.b == dcpu::POP) {
+		known = false;
+		return X_RETURN;
+	}
+	if(!known)
+		return X_INDIRECT;
+
+	// apply the command to PC
+	switch(entry.code) {
+		case dcpu::SET:
+			target = value;
+			break;
+		case dcpu::ADD:
+			target = pc + value;
+			break;
+		case dcpu::SUB:
+			target = pc - value;
+			break;
+		case dcpu::MUL:
+			target = pc * value;
+			break;
+		case dcpu::DIV:
+			target = value ? pc / value : LOW;
+			break;
+		case dcpu::MOD:
+			target = value ? pc % value : LOW;
+			break;
+		case dcpu::SHL:
+			target = pc << (value & dcpu::SHIFT_MASK);
+			break;
+		case dcpu::SHR:
+			target = pc >> (value & dcpu::SHIFT_MASK);
+			break;
+		case dcpu::AND:
+			target = pc & value;
+			break;
+		case dcpu::BOR:
+			target = pc | value;
+			break;
+		default:
+			target = pc ^ value;
+			break;
+	}
+	return X_JUMP;
+}
+
+/*
+ * Clear all blocks & edges
+ */
+void cfg::clear(void) {
+	nodes.clear();
+	links.clear();
+}
+
+/*
+ * Return a Graphviz DOT representation, disassembled from memory
+ *
+ * Blocks are boxes of left-justified commands; targets outside the
+ * range are dashed.
+ */
+std::string cfg::dot(mem128 &mem) {
+	std::vector<bool> outside(COUNT, false);
+	std::string out = "digraph cfg {\n\tnode [shape=box, fontname=\"monospace\"];\n";
+	word address, length;
+	char buf[0x40];
+
+	// blocks, labelled with their commands
+	for(size_t i = 0; i < nodes.size(); ++i) {
+		const block &node = nodes[i];
+
+		std::snprintf(buf, sizeof(buf), "\tn%04X [label=\"", node.start);
+		out += buf;
+		address = node.start;
+		for(dword j = 0; j < node.count; ++j) {
+			std::snprintf(buf, sizeof(buf), "0x%04X: ", address);
+			out += buf + disasm::at(mem, address, length) + "\\l";
+			address += length;
+		}
+		out += (node.start == entry) ? "\", style=bold];\n" : "\"];\n";
+	}
+
+	// edges, labelled with their kind
+	for(size_t i = 0; i < links.size(); ++i) {
+		const edge &link = links[i];
+
+		if(!find(link.to)
+				&& !outside[link.to]) {
+			outside[link.to] = true;
+			std::snprintf(buf, sizeof(buf), "\tn%04X [label=\"0x%04X\", style=dashed];\n", link.to, link.to);
+			out += buf;
+		}
+		std::snprintf(buf, sizeof(buf), "\tn%04X -> n%04X [label=\"%s\"];\n", link.from, link.to,
+				EDGE_NAME[link.kind]);
+		out += buf;
+	}
+	return out + "}\n";
+}
+
+/*
+ * Return a text listing of blocks & edges (and the unreached words
+ * between them), disassembled from memory
+ */
+std::string cfg::dump(mem128 &mem) {
+	std::string out;
+	dword at = 0, end;
+	word address, length;
+	char buf[0x80];
+
+	// print unreached words from at up to a position in the range
+	auto unreached = [&](dword to) {
+		while(at < to) {
+			if(flags[(word) (offset + at)] & A_COVER) {
+				++at;
+				continue;
+			}
+			for(end = at; end < to && !(flags[(word) (offset + end)] & A_COVER); ++end);
+			std::snprintf(buf, sizeof(buf), "0x%04X - 0x%04X: unreached (%u words)\n\n",
+					(word) (offset + at), (word) (offset + end - 1), end - at);
+			out += buf;
+			at = end;
+		}
+	};
+
+	for(size_t i = 0; i < nodes.size(); ++i) {
+		const block &node = nodes[i];
+
+		// block header & commands
+		unreached((word) (node.start - offset));
+		std::snprintf(buf, sizeof(buf), "0x%04X - 0x%04X: %u command%s, %s\n", node.start,
+				(word) (node.start + node.length - 1), node.count, (node.count == 1) ? "" : "s",
+				EXIT_NAME[node.exit]);
+		out += buf;
+		address = node.start;
+		for(dword j = 0; j < node.count; ++j) {
+			std::snprintf(buf, sizeof(buf), "\t0x%04X: ", address);
+			out += buf + disasm::at(mem, address, length) + "\n";
+			address += length;
+		}
+
+		// outgoing edges
+		for(dword j = node.edge; j < node.edge + node.edges; ++j) {
+			std::snprintf(buf, sizeof(buf), "\t-> 0x%04X (%s%s)\n", links[j].to, EDGE_NAME[links[j].kind],
+					inside(links[j].to) ? "" : ", outside");
+			out += buf;
+		}
+		out += "\n";
+		at = std::max<dword>(at, (word) (node.start - offset) + node.length);
+	}
+	unreached(range);
+	return out;
+}
+
+/*
+ * Return edges in block order
+ */
+const std::vector<cfg::edge> &cfg::edges(void) {
+	return links;
+}
+
+/*
+ * Return the block starting at an address (or NULL)
+ */
+const cfg::block *cfg::find(word address) {
+	std::vector<block>::const_iterator iter = std::lower_bound(nodes.begin(), nodes.end(), address,
+			[](const block &node, word address) {
+				return node.start < address;
+			});
+
+	return (iter != nodes.end() && iter->start == address) ? &*iter : NULL;
+}
+
+/*
+ * Return the address a failed IF* at an address skips to
+ * (past the command after it and any IF* chained before that command)
+ */
+word cfg::skip(mem128 &mem, word address) {
+	const decode::op *entry;
+	dword count = 0;
+
+	do {
+		entry = &decode::at(mem.at(address));
+		address += entry->length;
+	} while(entry->code >= dcpu::IFE
+			&& ++count < COUNT);
+	return address;
+}
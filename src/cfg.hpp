@@ -0,0 +1,188 @@
+/*
+ * cfg.hpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CFG_HPP_
+#define CFG_HPP_
+
+#include <string>
+#include <vector>
+#include "mem128.hpp"
+#include "types.hpp"
+
+class cfg {
+public:
+
+	/*
+	 * Block exits
+	 *
+	 * X_FALL:	falls into the next block (it is a branch or call target)
+	 * X_BRANCH:	IF* (runs or skips the commands after it)
+	 * X_JUMP:	SET | ADD | SUB ... PC to a known target
+	 * X_CALL:	JSR (returns to the command after it)
+	 * X_RETURN:	SET PC, POP
+	 * X_INDIRECT:	write to PC through a computed target
+	 * X_INVALID:	reserved non-basic opcode
+	 * X_END:	runs off the end of the range
+	 */
+	enum EXIT { X_FALL, X_BRANCH, X_JUMP, X_CALL, X_RETURN, X_INDIRECT, X_INVALID, X_END };
+
+	/*
+	 * Edge kinds
+	 *
+	 * E_FALL:	fall through (or return from a call)
+	 * E_TAKEN:	IF* condition holds
+	 * E_SKIP:	IF* condition fails (past any chained IF*)
+	 * E_JUMP:	jump to a known target
+	 * E_CALL:	call to a known target
+	 */
+	enum EDGE { E_FALL, E_TAKEN, E_SKIP, E_JUMP, E_CALL };
+
+	/*
+	 * Basic block
+	 *
+	 * start:	address of the first command
+	 * length:	length in words
+	 * count:	command count
+	 * exit:	exit kind
+	 * edge:	index of the first outgoing edge
+	 * edges:	outgoing edge count
+	 */
+	typedef struct {
+		word start;
+		dword length;
+		dword count;
+		halfword exit;
+		dword edge;
+		halfword edges;
+	} block;
+
+	/*
+	 * Control flow edge (targets outside the range are kept, but not followed)
+	 */
+	typedef struct {
+		word from;
+		word to;
+		halfword kind;
+	} edge;
+
+	/*
+	 * Control flow graph constructor
+	 */
+	cfg(void);
+
+	/*
+	 * Control flow graph destructor
+	 */
+	virtual ~cfg(void);
+
+	/*
+	 * Return blocks in address order
+	 */
+	const std::vector<block> &blocks(void);
+
+	/*
+	 * Build the graph of commands reached from an entry address,
+	 * following control flow within a range of memory (clipped to the
+	 * end of memory)
+	 */
+	void build(mem128 &mem, word entry = 0, word offset = 0, dword range = COUNT);
+
+	/*
+	 * Clear all blocks & edges
+	 */
+	void clear(void);
+
+	/*
+	 * Return a Graphviz DOT representation, disassembled from memory
+	 */
+	std::string dot(mem128 &mem);
+
+	/*
+	 * Return a text listing of blocks & edges (and the unreached words
+	 * between them), disassembled from memory
+	 */
+	std::string dump(mem128 &mem);
+
+	/*
+	 * Return edges in block order
+	 */
+	const std::vector<edge> &edges(void);
+
+	/*
+	 * Return the block starting at an address (or NULL)
+	 */
+	const block *find(word address);
+
+private:
+
+	/*
+	 * Address flags
+	 *
+	 * A_SEEN:	a command starts here
+	 * A_LEADER:	a block starts here
+	 * A_COVER:	word is part of a reached command
+	 */
+	enum ADDRESS { A_SEEN = 0x1, A_LEADER = 0x2, A_COVER = 0x4 };
+
+	/*
+	 * Entry address & range
+	 */
+	word entry, offset;
+	dword range;
+
+	/*
+	 * Flags per address
+	 */
+	std::vector<halfword> flags;
+
+	/*
+	 * Block index per block start address
+	 */
+	std::vector<dword> index;
+
+	/*
+	 * Blocks in address order
+	 */
+	std::vector<block> nodes;
+
+	/*
+	 * Edges in block order
+	 */
+	std::vector<edge> links;
+
+	/*
+	 * Classify the command at an address, setting the address after it
+	 * and its target (known is cleared if the target is computed at run time)
+	 */
+	static halfword classify(mem128 &mem, word address, word &next, word &target, bool &known);
+
+	/*
+	 * Determine if an address is inside the range
+	 */
+	bool inside(word address) {
+		return (dword) (word) (address - offset) < range;
+	}
+
+	/*
+	 * Return the address a failed IF* at an address skips to
+	 */
+	static word skip(mem128 &mem, word address);
+};
+
+#endif
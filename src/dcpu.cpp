@@ -17,28 +17,44 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cstdint>
+#include <cstring>
 #include <sstream>
 #include "dcpu.hpp"
+#include "jit.hpp"
+#include "profiler.hpp"
+#include "tracer.hpp"
+#include "writer.hpp"
 
 /*
  * Cpu constructor
  */
-dcpu::dcpu(void) {
+dcpu::dcpu(void) : engine(INTERP), compiler(NULL), spin(), hits() {
+	bind();
 	reset();
 }
 
 /*
  * Cpu constructor
  */
-dcpu::dcpu(const dcpu &other) : m_reg(other.m_reg), s_reg(other.s_reg), mem(other.mem),
-		state(other.state), cycle(other.cycle) {
-	return;
+dcpu::dcpu(const dcpu &other) : ctx(other.ctx), mem(other.mem), engine(other.engine), compiler(NULL),
+		breaks(other.breaks), spin(), hits() {
+	bind();
 }
 
 /*
  * Cpu constructor
  */
-dcpu::dcpu(const mem128 &mem) : mem(mem) {
+dcpu::dcpu(word engine) : engine(engine), compiler(NULL), spin(), hits() {
+	bind();
+	reset();
+}
+
+/*
+ * Cpu constructor
+ */
+dcpu::dcpu(const mem128 &mem) : mem(mem), engine(INTERP), compiler(NULL), spin(), hits() {
+	bind();
 	reset();
 }
 
@@ -46,15 +62,23 @@ dcpu::dcpu(const mem128 &mem) : mem(mem) {
  * Cpu constructor
  */
 dcpu::dcpu(const reg16 (&m_reg)[M_REG_COUNT], const reg16 (&s_reg)[S_REG_COUNT], const mem128 &mem,
-		word state, size_t cycle) : m_reg(m_reg), s_reg(s_reg), mem(mem), state(state), cycle(cycle) {
-	return;
+		word state, size_t cycle) : mem(mem), engine(INTERP), compiler(NULL), spin(), hits() {
+	bind();
+
+	// copy registers into the execution state
+	for(word i = 0; i < M_REG_COUNT; ++i)
+		ctx.reg[i] = reg16(m_reg[i]).get();
+	for(word i = 0; i < S_REG_COUNT; ++i)
+		ctx.reg[M_REG_COUNT + i] = reg16(s_reg[i]).get();
+	ctx.state = state;
+	ctx.cycle = cycle;
 }
 
 /*
  * Cpu destructor
  */
 dcpu::~dcpu(void) {
-	return;
+	delete compiler;
 }
 
 /*
@@ -67,13 +91,11 @@ dcpu &dcpu::operator=(const dcpu &other) {
 		return *this;
 
 	// set attributes
-	for(word i = 0; i < M_REG_COUNT; ++i)
-		m_reg[i] = other.m_reg[i];
-	for(word i = 0; i < S_REG_COUNT; ++i)
-		s_reg[i] = other.s_reg[i];
+	ctx = other.ctx;
 	mem = other.mem;
-	state = other.state;
-	cycle = other.cycle;
+	engine = other.engine;
+	breaks = other.breaks;
+	spin = sample();
 	return *this;
 }
 
@@ -87,15 +109,12 @@ bool dcpu::operator==(const dcpu &other) {
 		return true;
 
 	// check attributes
-	for(word i = 0; i < M_REG_COUNT; ++i)
-		if(m_reg[i] != other.m_reg[i])
-			return false;
-	for(word i = 0; i < S_REG_COUNT; ++i)
-		if(s_reg[i] != other.s_reg[i])
+	for(word i = 0; i < REG_COUNT; ++i)
+		if(ctx.reg[i] != other.ctx.reg[i])
 			return false;
 	return mem == other.mem
-			&& state == other.state
-			&& cycle == other.cycle;
+			&& ctx.state == other.ctx.state
+			&& ctx.cycle == other.ctx.cycle;
 }
 
 /*
@@ -108,108 +127,117 @@ bool dcpu::operator!=(const dcpu &other) {
 /*
  * Add B to A (sets overflow)
  */
-void dcpu::_add(word a, word b, bool exe) {
+template<word A_MODE, word B_MODE> bool dcpu::_add(const decode::op &entry, bool exe) {
+	word a_lit, b_lit;
 
-	// retrieve address
-	word *a_addr = get_address(a, exe);
-
-	// properly set PC
-	if((a >= L_OFF && a <= H_OFF)
-			|| a == ADR_OFF
-			|| a == LIT_OFF)
-		--s_reg[PC];
-
-	// retrieve values
-	word a_val = get_value(a, exe);
-	word b_val = get_value(b, exe);
-	dword res = a_val + b_val;
+	// retrieve operands
+	word *a_addr = operand<A_MODE>(entry.a, a_lit);
+	word a_val = *a_addr;
+	word b_val = *operand<B_MODE>(entry.b, b_lit);
 
 	// execute command
 	if(exe) {
+		dword res = a_val + b_val;
 
 		// set overflow
 		if(res >= HIGH)
-			s_reg[OVERFLOW].set(FLAG);
+			ctx.reg[R_OVERFLOW] = FLAG;
 		else
-			s_reg[OVERFLOW].set(LOW);
+			ctx.reg[R_OVERFLOW] = LOW;
 
 		// perform addition
-		set_value(a, a_addr, res);
-		cycle += 2;
+		write<A_MODE>(a_addr, res);
+		ctx.cycle += entry.cost;
 	}
+	return true;
 }
 
 /*
  * Binary AND of A and B
  */
-void dcpu::_and(word a, word b, bool exe) {
+template<word A_MODE, word B_MODE> bool dcpu::_and(const decode::op &entry, bool exe) {
+	word a_lit, b_lit;
 
-	// retrieve address
-	word *a_addr = get_address(a, exe);
-
-	// properly set PC
-	if((a >= L_OFF && a <= H_OFF)
-			|| a == ADR_OFF
-			|| a == LIT_OFF)
-		--s_reg[PC];
-
-	// retrieve values
-	word a_val = get_value(a, exe);
-	word b_val = get_value(b, exe);
+	// retrieve operands
+	word *a_addr = operand<A_MODE>(entry.a, a_lit);
+	word a_val = *a_addr;
+	word b_val = *operand<B_MODE>(entry.b, b_lit);
 
 	// execute command
 	if(exe) {
 
 		// perform binary operation
-		set_value(a, a_addr, a_val & b_val);
-		++cycle;
+		write<A_MODE>(a_addr, a_val & b_val);
+		ctx.cycle += entry.cost;
 	}
+	return true;
 }
 
 /*
- * Binary OR of A and B
+ * Fused ADD | SUB followed by a conditional
  */
-void dcpu::_bor(word a, word b, bool exe) {
-
-	// retrieve address
-	word *a_addr = get_address(a, exe);
+template<word CODE, word FORM, word IF_CODE, word IF_FORM> bool dcpu::_arith_if(const line &cached) {
+	const decode::op &entry = *cached.entry, &test = *cached.second;
+	word &a_reg = ctx.reg[entry.a], b_val = source<FORM>(entry.b);
+
+	// update register
+	if(CODE == ADD) {
+		dword res = a_reg + b_val;
+		ctx.reg[R_OVERFLOW] = (res >= HIGH) ? FLAG : LOW;
+		a_reg = res;
+	} else {
+		ctx.reg[R_OVERFLOW] = (b_val > a_reg) ? HIGH : LOW;
+		a_reg -= b_val;
+	}
+	ctx.cycle += entry.cost + test.cost;
+	ctx.reg[R_PC] += 2;
+	++hits[decode::F_ARITH_IF];
+
+	// run the next command when taken (stepping over a malformed one),
+	// skip it adding a cycle otherwise
+	if(condition<IF_CODE>(ctx.reg[test.a], source<IF_FORM>(test.b))) {
+		const decode::op &taken = decode::at(mem.at(ctx.reg[R_PC]));
+		if(taken.code == NB
+				&& taken.a != JSR)
+			ctx.reg[R_PC]++;
+	} else {
+		++ctx.cycle;
+		skip();
+	}
+	return true;
+}
 
-	// properly set PC
-	if((a >= L_OFF && a <= H_OFF)
-			|| a == ADR_OFF
-			|| a == LIT_OFF)
-		--s_reg[PC];
+/*
+ * Binary OR of A and B
+ */
+template<word A_MODE, word B_MODE> bool dcpu::_bor(const decode::op &entry, bool exe) {
+	word a_lit, b_lit;
 
-	// retrieve values
-	word a_val = get_value(a, exe);
-	word b_val = get_value(b, exe);
+	// retrieve operands
+	word *a_addr = operand<A_MODE>(entry.a, a_lit);
+	word a_val = *a_addr;
+	word b_val = *operand<B_MODE>(entry.b, b_lit);
 
 	// execute command
 	if(exe) {
 
 		// perform binary operation
-		set_value(a, a_addr, a_val | b_val);
-		++cycle;
+		write<A_MODE>(a_addr, a_val | b_val);
+		ctx.cycle += entry.cost;
 	}
+	return true;
 }
 
 /*
  * Division of A by B (sets overflow)
  */
-void dcpu::_div(word a, word b, bool exe) {
-
-	// retrieve address
-	word *a_addr = get_address(a, exe);
+template<word A_MODE, word B_MODE> bool dcpu::_div(const decode::op &entry, bool exe) {
+	word a_lit, b_lit;
 
-	// properly set PC
-	if((a >= L_OFF && a <= H_OFF)
-			|| a == ADR_OFF
-			|| a == LIT_OFF)
-		--s_reg[PC];
-
-	// retrieve values
-	word a_val = get_value(a, exe);
-	word b_val = get_value(b, exe);
+	// retrieve operands
+	word *a_addr = operand<A_MODE>(entry.a, a_lit);
+	word a_val = *a_addr;
+	word b_val = *operand<B_MODE>(entry.b, b_lit);
 
 	// execute command
 	if(exe) {
@@ -218,324 +246,480 @@ void dcpu::_div(word a, word b, bool exe) {
 		if(!b_val) {
 
 			// set overflow
-			s_reg[OVERFLOW].set(LOW);
-			set_value(a, a_addr, LOW);
+			ctx.reg[R_OVERFLOW] = LOW;
+			write<A_MODE>(a_addr, LOW);
 		} else {
 
 			// set overflow
-			s_reg[OVERFLOW].set(((a_val << 16) / b_val) & HIGH);
+			ctx.reg[R_OVERFLOW] = ((a_val << 16) / b_val) & HIGH;
 
-			// perform addition
-			set_value(a, a_addr, a_val / b_val);
+			// perform division
+			write<A_MODE>(a_addr, a_val / b_val);
 		}
-		cycle += 3;
+		ctx.cycle += entry.cost;
 	}
+	return true;
 }
 
 /*
  * Execute next instruction if ((A & B) != 0)
  */
-void dcpu::_ifb(word a, word b, bool exe) {
-	bool execute = false;
-
-	// retrieve values
-	word a_val = get_value(a, exe);
-	word b_val = get_value(b, exe);
-
-	// check condition
-	if(a_val & b_val)
-		execute = true;
-	else
+template<word A_MODE, word B_MODE, bool SPLIT> bool dcpu::_ifb(const decode::op &entry, bool exe) {
+	word a_lit, b_lit;
 
-		// add cycle on fail
-		++cycle;
-	exec(mem.at(s_reg[PC].get()), exe && execute);
-	cycle += 2;
+	// retrieve operands
+	word a_val = *operand<A_MODE>(entry.a, a_lit);
+	word b_val = *operand<B_MODE>(entry.b, b_lit);
+	_if<SPLIT>(entry, exe, a_val & b_val);
+	return true;
 }
 
 /*
  * Execute next instruction if (A == B)
  */
-void dcpu::_ife(word a, word b, bool exe) {
-	bool execute = false;
-
-	// retrieve values
-	word a_val = get_value(a, exe);
-	word b_val = get_value(b, exe);
+template<word A_MODE, word B_MODE, bool SPLIT> bool dcpu::_ife(const decode::op &entry, bool exe) {
+	word a_lit, b_lit;
 
-	// check condition
-	if(a_val == b_val)
-		execute = true;
-	else
-
-		// add cycle on fail
-		++cycle;
-	exec(mem.at(s_reg[PC].get()), exe && execute);
-	cycle += 2;
+	// retrieve operands
+	word a_val = *operand<A_MODE>(entry.a, a_lit);
+	word b_val = *operand<B_MODE>(entry.b, b_lit);
+	_if<SPLIT>(entry, exe, a_val == b_val);
+	return true;
 }
 
 /*
  * Execute next instruction if (A > B)
  */
-void dcpu::_ifg(word a, word b, bool exe) {
-	bool execute = false;
-
-	// retrieve values
-	word a_val = get_value(a, exe);
-	word b_val = get_value(b, exe);
-
-	// check condition
-	if(a_val > b_val)
-		execute = true;
-	else
+template<word A_MODE, word B_MODE, bool SPLIT> bool dcpu::_ifg(const decode::op &entry, bool exe) {
+	word a_lit, b_lit;
 
-		// add cycle on fail
-		++cycle;
-	exec(mem.at(s_reg[PC].get()), exe && execute);
-	cycle += 2;
+	// retrieve operands
+	word a_val = *operand<A_MODE>(entry.a, a_lit);
+	word b_val = *operand<B_MODE>(entry.b, b_lit);
+	_if<SPLIT>(entry, exe, a_val > b_val);
+	return true;
 }
 
 /*
  * Execute next instruction if (A != B)
  */
-void dcpu::_ifn(word a, word b, bool exe) {
-	bool execute = false;
-
-	// retrieve values
-	word a_val = get_value(a, exe);
-	word b_val = get_value(b, exe);
+template<word A_MODE, word B_MODE, bool SPLIT> bool dcpu::_ifn(const decode::op &entry, bool exe) {
+	word a_lit, b_lit;
 
-	// check condition
-	if(a_val != b_val)
-		execute = true;
-	else
+	// retrieve operands
+	word a_val = *operand<A_MODE>(entry.a, a_lit);
+	word b_val = *operand<B_MODE>(entry.b, b_lit);
+	_if<SPLIT>(entry, exe, a_val != b_val);
+	return true;
+}
 
-		// add cycle on fail
-		++cycle;
-	exec(mem.at(s_reg[PC].get()), exe && execute);
-	cycle += 2;
+/*
+ * Fused conditional followed by a jump
+ */
+template<word CODE, word FORM> bool dcpu::_if_jump(const line &cached) {
+	const decode::op &entry = *cached.entry;
+
+	// jump when taken, skip the jump adding a cycle otherwise
+	ctx.cycle += entry.cost;
+	++hits[decode::F_IF_JUMP];
+	if(condition<CODE>(ctx.reg[entry.a], source<FORM>(entry.b))) {
+		ctx.reg[R_PC] = cached.next[0];
+		ctx.cycle += cached.second->cost;
+	} else {
+		ctx.reg[R_PC] = cached.last + 1;
+		++ctx.cycle;
+	}
+	return true;
 }
 
 /*
  * Push the address of the next word onto the stack
+ * (the operand is held in B, A holds the non-basic opcode)
  */
-void dcpu::_jsr(word a, bool exe) {
+template<word A_MODE, word B_MODE> bool dcpu::_jsr(const decode::op &entry, bool exe) {
+	word b_lit;
+
+	// retrieve operand (before pushing, so PC points past any next word)
+	word b_val = *operand<B_MODE>(entry.b, b_lit);
 
 	// execute command
 	if(exe) {
 
 		// move to sub-routine
-		mem.set((--s_reg[SP]).get(), s_reg[PC].get());
-		s_reg[PC].set(get_value(a, exe));
-		cycle += 2;
+		mem.set(--ctx.reg[R_SP], ctx.reg[R_PC]);
+		ctx.reg[R_PC] = b_val;
+		ctx.cycle += entry.cost;
 	}
+	return true;
 }
 
 /*
- * Modulus of A by B
+ * Fused JSR to a literal target
  */
-void dcpu::_mod(word a, word b, bool exe) {
+bool dcpu::_jsr_lit(const line &cached) {
+
+	// move to sub-routine
+	mem.set(--ctx.reg[R_SP], cached.last + 1);
+	ctx.reg[R_PC] = cached.next[0];
+	ctx.cycle += cached.entry->cost;
+	++hits[decode::F_JSR];
+	return true;
+}
+
+/*
+ * Run a pre-decoded command (next words are taken from the line)
+ */
+template<word CODE, word A_MODE, word B_MODE> bool dcpu::_line(const line &cached) {
+	const decode::op &entry = *cached.entry;
+	const word *next = cached.next;
+	word a_lit, b_lit, *a_addr, a_val, b_val;
+	dword res;
+
+	// increment pc by one
+	ctx.reg[R_PC]++;
+
+	// non-basic commands hold their operand in B (only JSR is valid)
+	if(CODE == NB) {
+		if(A_MODE != JSR)
+			return false;
+		b_val = *operand<B_MODE>(entry.b, next, b_lit);
+		mem.set(--ctx.reg[R_SP], ctx.reg[R_PC]);
+		ctx.reg[R_PC] = b_val;
+		ctx.cycle += entry.cost;
+		return true;
+	}
+
+	// retrieve operands
+	a_addr = operand<A_MODE>(entry.a, next, a_lit);
+	a_val = *a_addr;
+	b_val = *operand<B_MODE>(entry.b, next, b_lit);
+	ctx.cycle += entry.cost;
+
+	// execute command
+	switch(CODE) {
+		case SET:
+			write<A_MODE>(a_addr, b_val);
+			break;
+		case ADD:
+			res = a_val + b_val;
+			ctx.reg[R_OVERFLOW] = (res >= HIGH) ? FLAG : LOW;
+			write<A_MODE>(a_addr, res);
+			break;
+		case SUB:
+			ctx.reg[R_OVERFLOW] = (b_val > a_val) ? HIGH : LOW;
+			write<A_MODE>(a_addr, a_val - b_val);
+			break;
+		case MUL:
+			ctx.reg[R_OVERFLOW] = ((a_val * b_val) >> 16) & HIGH;
+			write<A_MODE>(a_addr, a_val * b_val);
+			break;
+		case DIV:
+			if(!b_val) {
+				ctx.reg[R_OVERFLOW] = LOW;
+				write<A_MODE>(a_addr, LOW);
+			} else {
+				ctx.reg[R_OVERFLOW] = ((a_val << 16) / b_val) & HIGH;
+				write<A_MODE>(a_addr, a_val / b_val);
+			}
+			break;
+		case MOD:
+			write<A_MODE>(a_addr, b_val ? (a_val % b_val) : LOW);
+			break;
+		case SHL:
+			b_val &= SHIFT_MASK;
+			ctx.reg[R_OVERFLOW] = ((a_val << b_val) >> 16) & HIGH;
+			write<A_MODE>(a_addr, a_val << b_val);
+			break;
+		case SHR:
+			b_val &= SHIFT_MASK;
+			ctx.reg[R_OVERFLOW] = ((a_val << 16) >> b_val) & HIGH;
+			write<A_MODE>(a_addr, a_val >> b_val);
+			break;
+		case AND:
+			write<A_MODE>(a_addr, a_val & b_val);
+			break;
+		case BOR:
+			write<A_MODE>(a_addr, a_val | b_val);
+			break;
+		case XOR:
+			write<A_MODE>(a_addr, a_val ^ b_val);
+			break;
 
-	// retrieve address
-	word *a_addr = get_address(a, exe);
+		// conditionals leave the next command to the next dispatch when
+		// taken (stepping over a malformed one), skip it otherwise
+		default:
+			if((CODE == IFE && a_val == b_val)
+					|| (CODE == IFN && a_val != b_val)
+					|| (CODE == IFG && a_val > b_val)
+					|| (CODE == IFB && (a_val & b_val))) {
+				const decode::op &taken = decode::at(mem.at(ctx.reg[R_PC]));
+				if(taken.code == NB
+						&& taken.a != JSR)
+					ctx.reg[R_PC]++;
+			} else {
+				++ctx.cycle;
+				skip();
+			}
+			break;
+	}
+	return true;
+}
 
-	// properly set PC
-	if((a >= L_OFF && a <= H_OFF)
-			|| a == ADR_OFF
-			|| a == LIT_OFF)
-		--s_reg[PC];
+/*
+ * Modulus of A by B
+ */
+template<word A_MODE, word B_MODE> bool dcpu::_mod(const decode::op &entry, bool exe) {
+	word a_lit, b_lit;
 
-	// retrieve values
-	word a_val = get_value(a, exe);
-	word b_val = get_value(b, exe);
+	// retrieve operands
+	word *a_addr = operand<A_MODE>(entry.a, a_lit);
+	word a_val = *a_addr;
+	word b_val = *operand<B_MODE>(entry.b, b_lit);
 
 	// execute command
 	if(exe) {
 
 		// check if b value is zero
 		if(!b_val)
-			set_value(a, a_addr, LOW);
+			write<A_MODE>(a_addr, LOW);
 		else
 
 			// perform division
-			set_value(a, a_addr, a_val % b_val);
-		cycle += 3;
+			write<A_MODE>(a_addr, a_val % b_val);
+		ctx.cycle += entry.cost;
 	}
+	return true;
 }
 
 /*
  * Multiplication of B from A (sets overflow)
  */
-void dcpu::_mul(word a, word b, bool exe) {
+template<word A_MODE, word B_MODE> bool dcpu::_mul(const decode::op &entry, bool exe) {
+	word a_lit, b_lit;
 
-	// retrieve address
-	word *a_addr = get_address(a, exe);
-
-	// properly set PC
-	if((a >= L_OFF && a <= H_OFF)
-			|| a == ADR_OFF
-			|| a == LIT_OFF)
-		--s_reg[PC];
-
-	// retrieve values
-	word a_val = get_value(a, exe);
-	word b_val = get_value(b, exe);
+	// retrieve operands
+	word *a_addr = operand<A_MODE>(entry.a, a_lit);
+	word a_val = *a_addr;
+	word b_val = *operand<B_MODE>(entry.b, b_lit);
 
 	// execute command
 	if(exe) {
 
 		// set overflow
-		s_reg[OVERFLOW].set(((a_val * b_val) >> 16) & HIGH);
+		ctx.reg[R_OVERFLOW] = ((a_val * b_val) >> 16) & HIGH;
 
 		// perform multiplication
-		set_value(a, a_addr, a_val * b_val);
-		cycle += 2;
+		write<A_MODE>(a_addr, a_val * b_val);
+		ctx.cycle += entry.cost;
 	}
+	return true;
+}
+
+/*
+ * Fused pair of register pops
+ */
+bool dcpu::_pop_pair(const line &cached) {
+	word &sp = ctx.reg[R_SP];
+
+	ctx.reg[cached.entry->a] = mem.at(sp++);
+	ctx.reg[cached.second->a] = mem.at(sp++);
+	ctx.reg[R_PC] += 2;
+	ctx.cycle += cached.entry->cost + cached.second->cost;
+	++hits[decode::F_POP];
+	return true;
+}
+
+/*
+ * Fused pair of register pushes
+ */
+bool dcpu::_push_pair(const line &cached) {
+	word address = ctx.reg[R_PC];
+
+	mem.set(--ctx.reg[R_SP], ctx.reg[cached.entry->b]);
+	ctx.reg[R_PC] = address + 1;
+	ctx.cycle += cached.entry->cost;
+
+	// stop after the first push if it wrote over the pair
+	if(cached.version[0] != mem.page_version(address)
+			|| cached.version[1] != mem.page_version(cached.last))
+		return true;
+	mem.set(--ctx.reg[R_SP], ctx.reg[cached.second->b]);
+	ctx.reg[R_PC] = address + 2;
+	ctx.cycle += cached.second->cost;
+	++hits[decode::F_PUSH];
+	return true;
+}
+
+/*
+ * Reserved non-basic opcode (invalid)
+ */
+template<word A_MODE, word B_MODE> bool dcpu::_res(const decode::op &/* entry */, bool /* exe */) {
+	return false;
 }
 
 /*
  * Set A to B
  */
-void dcpu::_set(word a, word b, bool exe) {
+template<word A_MODE, word B_MODE> bool dcpu::_set(const decode::op &entry, bool exe) {
+	word a_lit, b_lit;
 
-	// retrieve info
-	word *addr = get_address(a, exe);
-	word value = get_value(b, exe);
+	// retrieve operands
+	word *a_addr = operand<A_MODE>(entry.a, a_lit);
+	word b_val = *operand<B_MODE>(entry.b, b_lit);
 
 	// execute command
 	if(exe) {
 
 		// perform set
-		set_value(a, addr, value);
-		++cycle;
+		write<A_MODE>(a_addr, b_val);
+		ctx.cycle += entry.cost;
 	}
+	return true;
 }
 
 /*
  * Shift-left A by B (sets overflow)
  */
-void dcpu::_shl(word a, word b, bool exe) {
-
-	// retrieve address
-	word *a_addr = get_address(a, exe);
+template<word A_MODE, word B_MODE> bool dcpu::_shl(const decode::op &entry, bool exe) {
+	word a_lit, b_lit;
 
-	// properly set PC
-	if((a >= L_OFF && a <= H_OFF)
-			|| a == ADR_OFF
-			|| a == LIT_OFF)
-		--s_reg[PC];
-
-	// retrieve values
-	word a_val = get_value(a, exe);
-	word b_val = get_value(b, exe);
+	// retrieve operands
+	word *a_addr = operand<A_MODE>(entry.a, a_lit);
+	word a_val = *a_addr;
+	word b_val = *operand<B_MODE>(entry.b, b_lit);
 
 	// execute command
 	if(exe) {
 
+		// wrap shift count
+		b_val &= SHIFT_MASK;
+
 		// set overflow
-		s_reg[OVERFLOW].set(((a_val << b_val) >> 16) & HIGH);
+		ctx.reg[R_OVERFLOW] = ((a_val << b_val) >> 16) & HIGH;
 
 		// perform shift
-		set_value(a, a_addr, a_val << b_val);
-		cycle += 2;
+		write<A_MODE>(a_addr, a_val << b_val);
+		ctx.cycle += entry.cost;
 	}
+	return true;
 }
 
 /*
  * Shift-right A by B (sets overflow)
  */
-void dcpu::_shr(word a, word b, bool exe) {
-
-	// retrieve address
-	word *a_addr = get_address(a, exe);
-
-	// properly set PC
-	if((a >= L_OFF && a <= H_OFF)
-			|| a == ADR_OFF
-			|| a == LIT_OFF)
-		--s_reg[PC];
+template<word A_MODE, word B_MODE> bool dcpu::_shr(const decode::op &entry, bool exe) {
+	word a_lit, b_lit;
 
-	// retrieve values
-	word a_val = get_value(a, exe);
-	word b_val = get_value(b, exe);
+	// retrieve operands
+	word *a_addr = operand<A_MODE>(entry.a, a_lit);
+	word a_val = *a_addr;
+	word b_val = *operand<B_MODE>(entry.b, b_lit);
 
 	// execute command
 	if(exe) {
 
+		// wrap shift count
+		b_val &= SHIFT_MASK;
+
 		// set overflow
-		s_reg[OVERFLOW].set(((a_val << 16) >> b_val) & HIGH);
+		ctx.reg[R_OVERFLOW] = ((a_val << 16) >> b_val) & HIGH;
 
 		// perform shift
-		set_value(a, a_addr, a_val >> b_val);
-		cycle += 2;
+		write<A_MODE>(a_addr, a_val >> b_val);
+		ctx.cycle += entry.cost;
 	}
+	return true;
 }
 
 /*
  * Subtraction of B from A (sets overflow)
  */
-void dcpu::_sub(word a, word b, bool exe) {
-
-	// retrieve address
-	word *a_addr = get_address(a, exe);
+template<word A_MODE, word B_MODE> bool dcpu::_sub(const decode::op &entry, bool exe) {
+	word a_lit, b_lit;
 
-	// properly set PC
-	if((a >= L_OFF && a <= H_OFF)
-			|| a == ADR_OFF
-			|| a == LIT_OFF)
-		--s_reg[PC];
-
-	// retrieve values
-	word a_val = get_value(a, exe);
-	word b_val = get_value(b, exe);
+	// retrieve operands
+	word *a_addr = operand<A_MODE>(entry.a, a_lit);
+	word a_val = *a_addr;
+	word b_val = *operand<B_MODE>(entry.b, b_lit);
 
 	// execute command
 	if(exe) {
 
 		// set overflow
 		if(b_val > a_val)
-			s_reg[OVERFLOW].set(HIGH);
+			ctx.reg[R_OVERFLOW] = HIGH;
 		else
-			s_reg[OVERFLOW].set(LOW);
+			ctx.reg[R_OVERFLOW] = LOW;
 
 		// perform subtraction
-		set_value(a, a_addr, a_val - b_val);
-		cycle += 2;
+		write<A_MODE>(a_addr, a_val - b_val);
+		ctx.cycle += entry.cost;
 	}
+	return true;
 }
 
 /*
  * Exclusive-OR of A and B
  */
-void dcpu::_xor(word a, word b, bool exe) {
-
-	// retrieve address
-	word *a_addr = get_address(a, exe);
+template<word A_MODE, word B_MODE> bool dcpu::_xor(const decode::op &entry, bool exe) {
+	word a_lit, b_lit;
 
-	// properly set PC
-	if((a >= L_OFF && a <= H_OFF)
-			|| a == ADR_OFF
-			|| a == LIT_OFF)
-		--s_reg[PC];
+	// retrieve operands
+	word *a_addr = operand<A_MODE>(entry.a, a_lit);
+	word a_val = *a_addr;
+	word b_val = *operand<B_MODE>(entry.b, b_lit);
 
 	// execute command
 	if(exe) {
 
-		// retrieve values
-		word a_val = get_value(a, exe);
-		word b_val = get_value(b, exe);
-
 		// perform binary operation
-		set_value(a, a_addr, a_val ^ b_val);
-		++cycle;
+		write<A_MODE>(a_addr, a_val ^ b_val);
+		ctx.cycle += entry.cost;
+	}
+	return true;
+}
+
+/*
+ * Run the next instruction if a condition holds (or leave it to run
+ * as its own step when splitting), skip it otherwise
+ */
+template<bool SPLIT> void dcpu::_if(const decode::op &entry, bool exe, bool cond) {
+	if(!exe)
+		return;
+	ctx.cycle += entry.cost;
+
+	// run the next command (stepping over a malformed one), or
+	// skip it adding a cycle on fail
+	if(cond) {
+		if(!SPLIT)
+			exec(mem.at(ctx.reg[R_PC]), true);
+	} else {
+		++ctx.cycle;
+		skip();
 	}
 }
 
 /*
- * Returns a Cpu cycle count
+ * Returns if a conditional opcode holds for two values
+ */
+template<word CODE> bool dcpu::condition(word a_val, word b_val) {
+	switch(CODE) {
+		case IFE:
+			return a_val == b_val;
+		case IFN:
+			return a_val != b_val;
+		case IFG:
+			return a_val > b_val;
+		default:
+			return a_val & b_val;
+	}
+}
+
+/*
+ * Returns a Cpu ctx.cycle count
  */
 size_t dcpu::cycles(void) {
-	return cycle;
+	return ctx.cycle;
 }
 
 /*
@@ -546,7 +730,7 @@ std::string dcpu::dump(void) {
 
 	// print attributes
 	ss << "STATE: ";
-	switch(state) {
+	switch(ctx.state) {
 		case INIT:
 			ss << "INIT";
 			break;
@@ -560,7 +744,7 @@ std::string dcpu::dump(void) {
 			ss << "UNKNOWN";
 			break;
 	}
-	ss << ", CYCLE: " << cycle << std::endl;
+	ss << ", CYCLE: " << ctx.cycle << std::endl;
 
 	// print all system registers
 	ss << "S_REG { ";
@@ -576,112 +760,46 @@ std::string dcpu::dump(void) {
 }
 
 /*
- * Dump cpu to file at a givne path
+ * Dump cpu to file at a givne path (registers, then memory if requested)
  */
-bool dcpu::dump_to_file(const std::string &path) {
-
-	// write system registers to file
-	for(word i = 0; i < S_REG_COUNT; ++i)
-		if(!s_reg[i].dump_to_file(path))
-			return false;
+bool dcpu::dump_to_file(const std::string &path, bool memory) {
+	writer file;
+
+	// write system registers, main registers (and memory) in one call
+	file.add(&ctx.reg[M_REG_COUNT], S_REG_COUNT);
+	file.add(&ctx.reg[0], M_REG_COUNT);
+	if(memory)
+		file.add(&mem.at(LOW), COUNT);
+	return file.write(path);
+}
 
-	// write main registers to file
+/*
+ * Bind register views to the execution state
+ */
+void dcpu::bind(void) {
 	for(word i = 0; i < M_REG_COUNT; ++i)
-		if(!m_reg[i].dump_to_file(path))
-			return false;
-	return true;
+		m_reg[i].bind(ctx.reg[i]);
+	for(word i = 0; i < S_REG_COUNT; ++i)
+		s_reg[i].bind(ctx.reg[M_REG_COUNT + i]);
 }
 
 /*
  * Execute a single command
  */
 bool dcpu::exec(word op, bool exe) {
-	word code = 0, a = 0, b = 0;
 
 	// check state
 	if(!is_running())
 		return false;
 
-	// parse opt-code, A & B from opt
-	for(size_t i = 0; i < 8 * sizeof(word); ++i)
-
-		// parse code
-		if(i < B_OP_LEN) {
-			if(op & (1 << i))
-				code |= (1 << i);
-
-		// parse A
-		} else if(i >= B_OP_LEN && i < B_OP_LEN + INPUT_LEN) {
-			if(op & (1 << i))
-				a |= (1 << (i - B_OP_LEN));
-
-		// parse B
-		} else {
-			if(op & (1 << i))
-				b |= (1 << (i - (B_OP_LEN + INPUT_LEN)));
-		}
+	// look up the decoded command
+	const decode::op &entry = decode::at(op);
 
 	// increment pc by one
-	s_reg[PC]++;
-
-	// execute command based on code
-	switch(code) {
-		case NB:
-			switch(a) {
-				case JSR: //std::cout << "[" << std::dec << s_reg[PC].get() << "] " << "JSR" << ": " << std::hex << b << " (" << (exe ? "EXECUTE" : "NOT EXECUTE") << ")" << std::endl;
-					_jsr(b, exe);
-					break;
-				default: return false;
-			}
-			break;
-		case SET: //std::cout << "[" << std::dec << s_reg[PC].get() << "] " << "SET" << ": " << std::hex << a << ", " << b << " (" << (exe ? "EXECUTE" : "NOT EXECUTE") << ")" << std::endl;
-			_set(a, b, exe);
-			break;
-		case ADD: //std::cout << "[" << std::dec << s_reg[PC].get() << "] " << "ADD" << ": " << std::hex << a << ", " << b << " (" << (exe ? "EXECUTE" : "NOT EXECUTE") << ")" << std::endl;
-			_add(a, b, exe);
-			break;
-		case SUB: //std::cout << "[" << std::dec << s_reg[PC].get() << "] " << "SUB" << ": " << std::hex << a << ", " << b << " (" << (exe ? "EXECUTE" : "NOT EXECUTE") << ")" << std::endl;
-			_sub(a, b, exe);
-			break;
-		case MUL: //std::cout << "[" << std::dec << s_reg[PC].get() << "] " << "MUL" << ": " << std::hex << a << ", " << b << " (" << (exe ? "EXECUTE" : "NOT EXECUTE") << ")" << std::endl;
-			_mul(a, b, exe);
-			break;
-		case DIV: //std::cout << "[" << std::dec << s_reg[PC].get() << "] " << "DIV" << ": " << std::hex << a << ", " << b << " (" << (exe ? "EXECUTE" : "NOT EXECUTE") << ")" << std::endl;
-			_div(a, b, exe);
-			break;
-		case MOD: //std::cout << "[" << std::dec << s_reg[PC].get() << "] " << "MOD" << ": " << std::hex << a << ", " << b << " (" << (exe ? "EXECUTE" : "NOT EXECUTE") << ")" << std::endl;
-			_mod(a, b, exe);
-			break;
-		case SHL: //std::cout << "[" << std::dec << s_reg[PC].get() << "] " << "SHL" << ": " << std::hex << a << ", " << b << " (" << (exe ? "EXECUTE" : "NOT EXECUTE") << ")" << std::endl;
-			_shl(a, b, exe);
-			break;
-		case SHR: //std::cout << "[" << std::dec << s_reg[PC].get() << "] " << "SHR" << ": " << std::hex << a << ", " << b << " (" << (exe ? "EXECUTE" : "NOT EXECUTE") << ")" << std::endl;
-			_shr(a, b, exe);
-			break;
-		case AND: //std::cout << "[" << std::dec << s_reg[PC].get() << "] " << "AND" << ": " << std::hex << a << ", " << b << " (" << (exe ? "EXECUTE" : "NOT EXECUTE") << ")" << std::endl;
-			_and(a, b, exe);
-			break;
-		case BOR: //std::cout << "[" << std::dec << s_reg[PC].get() << "] " << "BOR" << ": " << std::hex << a << ", " << b << " (" << (exe ? "EXECUTE" : "NOT EXECUTE") << ")" << std::endl;
-			_bor(a, b, exe);
-			break;
-		case XOR: //std::cout << "[" << std::dec << s_reg[PC].get() << "] " << "XOR" << ": " << std::hex << a << ", " << b << " (" << (exe ? "EXECUTE" : "NOT EXECUTE") << ")" << std::endl;
-			_xor(a, b, exe);
-			break;
-		case IFE: //std::cout << "[" << std::dec << s_reg[PC].get() << "] " << "IFE" << ": " << std::hex << a << ", " << b << " (" << (exe ? "EXECUTE" : "NOT EXECUTE") << ")" << std::endl;
-			_ife(a, b, exe);
-			break;
-		case IFN: //std::cout << "[" << std::dec << s_reg[PC].get() << "] " << "IFN" << ": " << std::hex << a << ", " << b << " (" << (exe ? "EXECUTE" : "NOT EXECUTE") << ")" << std::endl;
-			_ifn(a, b, exe);
-			break;
-		case IFG: //std::cout << "[" << std::dec << s_reg[PC].get() << "] " << "IFG" << ": " << std::hex << a << ", " << b << " (" << (exe ? "EXECUTE" : "NOT EXECUTE") << ")" << std::endl;
-			_ifg(a, b, exe);
-			break;
-		case IFB: //std::cout << "[" << std::dec << s_reg[PC].get() << "] " << "IFB" << ": " << std::hex << a << ", " << b << " (" << (exe ? "EXECUTE" : "NOT EXECUTE") << ")" << std::endl;
-			_ifb(a, b, exe);
-			break;
-		default: return false;
-	}
-	return true;
+	ctx.reg[R_PC]++;
+
+	// execute command through its specialized handler
+	return (this->*HANDLER[entry.handler])(entry, exe);
 }
 
 /*
@@ -704,157 +822,167 @@ bool dcpu::exec(word offset, word range, std::vector<word> &op) {
 }
 
 /*
- * Return an address of a value at a given location
+ * Execute a single command, leaving the command a passing IF*
+ * guards to run as its own step
  */
-word *dcpu::get_address(word value, bool exe) {
-
-	// register value
-	if(value >= L_REG && value <= H_REG) {
-		if(exe)
-			++cycle;
-		return &m_reg[value].get();
-	}
+bool dcpu::exec_split(word op) {
+	const decode::op &entry = decode::at(op);
 
-	// value at address in register
-	else if(value >= L_VAL && value <= H_VAL) {
-		if(exe)
-			++cycle;
-		return &mem.at(m_reg[value % M_REG_COUNT].get());
-	}
+	// conditionals run through their splitting handlers
+	if(entry.code < IFE)
+		return exec(op, true);
+	if(!is_running())
+		return false;
+	ctx.reg[R_PC]++;
+	return (this->*SPLIT_HANDLER[entry.handler - (IFE * decode::MODE_COUNT * decode::MODE_COUNT)])(entry, true);
+}
 
-	// value at address ((PC + 1) + register value)
-	else if(value >= L_OFF && value <= H_OFF) {
-		if(exe)
-			cycle += 2;
-		return &mem.at(mem.at(s_reg[PC]++.get()) + m_reg[value % M_REG_COUNT].get());
+/*
+ * Pre-decode the command at an address into its line
+ */
+dcpu::line &dcpu::fill(word address) {
+	line &cached = lines[address];
+	const decode::op *second;
+
+	// resolve handler & copy next words
+	cached.entry = &decode::at(mem.at(address));
+	cached.func = LINE_HANDLER[cached.entry->handler];
+	for(word i = 1; i < cached.entry->length; ++i)
+		cached.next[i - 1] = mem.at(address + i);
+	cached.last = address + cached.entry->length - 1;
+	cached.second = NULL;
+
+	// fuse a common idiom with the command after it
+	second = &decode::at(mem.at(cached.last + 1));
+	switch(decode::fuse(*cached.entry, *second)) {
+		case decode::F_IF_JUMP:
+			cached.func = IF_JUMP_HANDLER[cached.entry->code - IFE][cached.entry->form - decode::REG_REG];
+			cached.next[0] = (second->b == LIT_OFF) ? mem.at(cached.last + 2) : second->b % LIT_COUNT;
+			break;
+		case decode::F_PUSH:
+			cached.func = &dcpu::_push_pair;
+			break;
+		case decode::F_POP:
+			cached.func = &dcpu::_pop_pair;
+			break;
+		case decode::F_ARITH_IF:
+			cached.func = ARITH_IF_HANDLER[cached.entry->code - ADD][cached.entry->form - decode::REG_REG]
+					[second->code - IFE][second->form - decode::REG_REG];
+			break;
+		case decode::F_JSR:
+			if(cached.entry->b != LIT_OFF)
+				cached.next[0] = cached.entry->b % LIT_COUNT;
+			cached.func = &dcpu::_jsr_lit;
+			second = NULL;
+			break;
+		default:
+			second = NULL;
+			break;
 	}
-
-	// value at address in SP and increment SP
-	else if(value == POP) {
-		if(exe)
-			++cycle;
-		return &mem.at(s_reg[SP]++.get());
+	if(second) {
+		cached.second = second;
+		cached.last += second->length;
 	}
 
-	// value at address in SP
-	else if(value == PEEK) {
-		if(exe)
-			++cycle;
-		return &mem.at(s_reg[SP].get());
-	}
+	// a write to either page bumps its version
+	cached.version[0] = mem.page_version(address);
+	cached.version[1] = mem.page_version(cached.last);
+	mem.mark_code(address);
+	mem.mark_code(cached.last);
+	return cached;
+}
 
-	// value at address in SP
-	else if(value == PUSH) {
-		if(exe)
-			++cycle;
-		return &mem.at((--s_reg[SP]).get());
-	}
+/*
+ * Return the location of an operand, reading next words and
+ * adjusting SP as needed (literals are copied into literal)
+ */
+template<word MODE> word *dcpu::operand(word value, word &literal) {
+	switch(MODE) {
 
-	// value in SP
-	else if(value == SP_VAL)
-		return &s_reg[SP].get();
+		// register value
+		case decode::O_REG:
+			return &ctx.reg[value];
 
-	// value in PC
-	else if(value == PC_VAL)
-		return &s_reg[PC].get();
+		// value at address in register
+		case decode::O_VAL:
+			return &mem.at(ctx.reg[value % M_REG_COUNT]);
 
-	// value in overflow
-	else if(value == OVER_F)
-		return &s_reg[OVERFLOW].get();
+		// value at address (next word + register value)
+		case decode::O_OFF:
+			return &mem.at(mem.at(ctx.reg[R_PC]++) + ctx.reg[value % M_REG_COUNT]);
 
-	// value of address at PC + 1
-	else if(value == ADR_OFF) {
-		if(exe)
-			cycle += 2;
-		return &mem.at(mem.at(s_reg[PC]++.get()));
-	}
+		// value at address in SP and increment SP
+		case decode::O_POP:
+			return &mem.at(ctx.reg[R_SP]++);
 
-	// value at PC + 1
-	else if(value == LIT_OFF) {
-		if(exe)
-			++cycle;
-		return &mem.at(s_reg[PC]++.get());
-	}
-	return NULL;
-}
+		// value at address in SP
+		case decode::O_PEEK:
+			return &mem.at(ctx.reg[R_SP]);
 
-/*
- * Return a value held at a given location
- */
-word dcpu::get_value(word value, bool exe) {
+		// decrement SP and value at address in SP
+		case decode::O_PUSH:
+			return &mem.at(--ctx.reg[R_SP]);
 
-	// register value
-	if(value >= L_REG && value <= H_REG) {
-		if(exe)
-			++cycle;
-		return m_reg[value].get();
-	}
+		// value in SP
+		case decode::O_SP:
+			return &ctx.reg[R_SP];
 
-	// value at address in register
-	else if(value >= L_VAL && value <= H_VAL) {
-		if(exe)
-			++cycle;
-		return mem.at(m_reg[value % M_REG_COUNT].get());
-	}
+		// value in PC
+		case decode::O_PC:
+			return &ctx.reg[R_PC];
 
-	// value at address ((PC + 1) + register value)
-	else if(value >= L_OFF && value <= H_OFF) {
-		if(exe)
-			cycle += 2;
-		return mem.at(mem.at(s_reg[PC]++.get()) + m_reg[value % M_REG_COUNT].get());
-	}
+		// value in overflow
+		case decode::O_OVER:
+			return &ctx.reg[R_OVERFLOW];
 
-	// value at address in SP and increment SP
-	else if(value == POP) {
-		if(exe)
-			++cycle;
-		return mem.at(s_reg[SP]++.get());
-	}
+		// value at address in next word
+		case decode::O_ADR:
+			return &mem.at(mem.at(ctx.reg[R_PC]++));
 
-	// value at address in SP
-	else if(value == PEEK) {
-		if(exe)
-			++cycle;
-		return mem.at(s_reg[SP].get());
-	}
+		// next word
+		case decode::O_NEXT:
+			return &mem.at(ctx.reg[R_PC]++);
 
-	// value at address in SP
-	else if(value == PUSH) {
-		if(exe)
-			++cycle;
-		return mem.at((--s_reg[SP]).get());
+		// literal value from 0 - 31
+		default:
+			literal = value % LIT_COUNT;
+			return &literal;
 	}
+}
 
-	// value in SP
-	else if(value == SP_VAL)
-		return s_reg[SP].get();
+/*
+ * Return the location of an operand, taking next words from a line
+ * and adjusting SP as needed (literals are copied into literal)
+ */
+template<word MODE> word *dcpu::operand(word value, const word *&next, word &literal) {
+	switch(MODE) {
 
-	// value in PC
-	else if(value == PC_VAL)
-		return s_reg[PC]++.get();
+		// value at address (next word + register value)
+		case decode::O_OFF:
+			ctx.reg[R_PC]++;
+			return &mem.at(*next++ + ctx.reg[value % M_REG_COUNT]);
 
-	// value in overflow
-	else if(value == OVER_F)
-		return s_reg[OVERFLOW].get();
+		// value at address in next word
+		case decode::O_ADR:
+			ctx.reg[R_PC]++;
+			return &mem.at(*next++);
 
-	// value of address at PC + 1
-	else if(value == ADR_OFF) {
-		if(exe)
-			cycle += 2;
-		return mem.at(mem.at(s_reg[PC]++.get()));
-	}
+		// next word (kept in memory, as it may be written)
+		case decode::O_NEXT:
+			++next;
+			return &mem.at(ctx.reg[R_PC]++);
 
-	// value at PC + 1
-	else if(value == LIT_OFF) {
-		if(exe)
-			++cycle;
-		return mem.at(s_reg[PC]++.get());
+		// modes without next words
+		default:
+			return operand<MODE>(value, literal);
 	}
+}
 
-	// Literal value from 0 - 31
-	else if(value >= L_LIT && value <= H_LIT)
-		return value % LIT_COUNT;
-	return 0;
+/*
+ * Return how often a superinstruction ran on the cached engine
+ */
+size_t dcpu::fused(word kind) {
+	return hits[kind];
 }
 
 /*
@@ -868,7 +996,7 @@ bool dcpu::halt(void) {
  * Returns a Cpu running status
  */
 bool dcpu::is_running(void) {
-	return state == RUN;
+	return ctx.state == RUN;
 }
 
 /*
@@ -890,21 +1018,33 @@ mem128 &dcpu::memory(void) {
  */
 void dcpu::reset(void) {
 
-	// clear main registers
-	for(word i = 0; i < M_REG_COUNT; ++i)
-		m_reg[i].clear();
-
-	// clear system registers
-	for(word i = 0; i < S_REG_COUNT; ++i)
-		s_reg[i].clear();
+	// clear registers
+	for(word i = 0; i < REG_COUNT; ++i)
+		ctx.reg[i] = LOW;
 
 	// clean attributes
-	state = INIT;
-	cycle = 0;
+	ctx.state = INIT;
+	ctx.cycle = 0;
+	spin = sample();
+}
+
+/*
+ * Remove a breakpoint at an address
+ */
+void dcpu::remove_breakpoint(word address) {
+	if(!breaks.empty())
+		breaks[address / 32] &= ~(1 << (address % 32));
+}
+
+/*
+ * Remove all breakpoints
+ */
+void dcpu::remove_breakpoints(void) {
+	std::vector<dword>().swap(breaks);
 }
 
 /*
- * Run a Cpu
+ * Run a Cpu (ignoring breakpoints)
  */
 bool dcpu::run(void) {
 
@@ -914,11 +1054,349 @@ bool dcpu::run(void) {
 
 	// run until no more commands are found
 	// or a malformed command is found
-	while(exec(mem.at(s_reg[PC].get()), true));
+	run_limit(SIZE_MAX, false);
 	halt();
 	return true;
 }
 
+/*
+ * Run a Cpu for a budget of cycles, returning why it stopped
+ * (the budget is checked between basic blocks, so a run may end
+ * up to one block past it; a Cpu stopped by its budget or a
+ * breakpoint is left running and may be resumed)
+ */
+word dcpu::run(size_t budget) {
+	size_t limit = (budget > SIZE_MAX - ctx.cycle) ? SIZE_MAX : ctx.cycle + budget;
+
+	// attempt to change state (unless resuming)
+	if(!is_running())
+		state_change(RUN);
+	return run_limit(limit, true);
+}
+
+/*
+ * Run a Cpu for a budget of cycles through the interpreter,
+ * recording each command to a profiler or tracer (ignoring
+ * breakpoints)
+ */
+template<class PROFILER> word dcpu::run(size_t budget, PROFILER &prof) {
+	size_t limit = (budget > SIZE_MAX - ctx.cycle) ? SIZE_MAX : ctx.cycle + budget;
+	word reason;
+
+	// attempt to change state (unless resuming)
+	if(!is_running())
+		state_change(RUN);
+	reason = run_interp(limit, prof);
+	if(reason == INVALID)
+		halt();
+	return reason;
+}
+
+template word dcpu::run<profiler>(size_t budget, profiler &prof);
+template word dcpu::run<tracer>(size_t budget, tracer &prof);
+
+/*
+ * Run until the cycle count reaches limit, stopping at breakpoints
+ * past the first command (one command at a time)
+ */
+word dcpu::run_breakpoints(size_t limit) {
+
+	// first command may sit on the breakpoint the last run stopped at
+	if(ctx.cycle < limit
+			&& !exec(mem.at(ctx.reg[R_PC]), true))
+		return is_running() ? INVALID : HALTED;
+	while(ctx.cycle < limit) {
+		word pc = ctx.reg[R_PC];
+
+		if(is_breakpoint(pc))
+			return BREAKPOINT;
+		if(!exec(mem.at(pc), true))
+			return is_running() ? INVALID : HALTED;
+		if(is_idle(pc))
+			return IDLE;
+	}
+	return BUDGET;
+}
+
+/*
+ * Run until the cycle count reaches limit (pre-decoded commands,
+ * one at a time)
+ *
+ * Lines are filled on first run at an address and refilled once a
+ * write bumps the version of a page they were read from, so state is
+ * identical to the interpreter.
+ */
+word dcpu::run_cached(size_t limit) {
+
+	// lines are kept across runs
+	if(lines.empty())
+		lines.resize(COUNT);
+	if(!is_running())
+		return HALTED;
+
+	while(ctx.cycle < limit) {
+		word pc = ctx.reg[R_PC];
+		line *cached = &lines[pc];
+
+		// refill a line not yet filled or read from a written page
+		if(!cached->func
+				|| cached->version[0] != mem.page_version(pc)
+				|| cached->version[1] != mem.page_version(cached->last))
+			cached = &fill(pc);
+		if(!(this->*cached->func)(*cached))
+			return INVALID;
+		if(is_idle(pc))
+			return IDLE;
+	}
+	return BUDGET;
+}
+
+/*
+ * Run until the cycle count reaches limit (one command at a time)
+ */
+word dcpu::run_interp(size_t limit) {
+	profiler::none prof;
+
+	return run_interp(limit, prof);
+}
+
+/*
+ * Run until the cycle count reaches limit (one command at a time),
+ * recording each command to a profiler policy
+ *
+ * When the policy splits (PROFILER::SPLIT), the command a passing IF*
+ * guards runs as the next step, before any stop, so state matches an
+ * unsplit run. Otherwise guarded stays false and the checks compile out.
+ */
+template<class PROFILER> word dcpu::run_interp(size_t limit, PROFILER &prof) {
+	bool guarded = false;
+
+	while(ctx.cycle < limit
+			|| (PROFILER::SPLIT && guarded)) {
+		word pc = ctx.reg[R_PC], op = mem.at(pc);
+		size_t cycle = ctx.cycle;
+
+		// a guarded command steps over a malformed one
+		prof.fetch(pc, op);
+		if(!(PROFILER::SPLIT ? exec_split(op) : exec(op, true))
+				&& !guarded)
+			return is_running() ? INVALID : HALTED;
+		prof.record(pc, op, ctx.cycle - cycle);
+		if(PROFILER::SPLIT) {
+			const decode::op &entry = decode::at(op);
+			guarded = entry.code >= IFE
+					&& ctx.reg[R_PC] == (word) (pc + entry.length);
+		}
+		if(!guarded
+				&& is_idle(pc))
+			return IDLE;
+	}
+	return BUDGET;
+}
+
+/*
+ * Run until the cycle count reaches limit (native basic blocks,
+ * checking the limit between blocks)
+ *
+ * Blocks run directly on the flat register file; commands the
+ * translator rejects are run through exec one at a time.
+ */
+word dcpu::run_jit(size_t limit) {
+
+	// translator is kept across runs
+	if(!compiler)
+		compiler = new jit;
+
+	// run through the interpreter if translation is unavailable
+	if(!compiler->available())
+		return run_interp(limit);
+
+	while(ctx.cycle < limit) {
+		word pc = ctx.reg[R_PC];
+
+		// run a translated block, or a single command through the
+		// interpreter
+		if(!compiler->exec(ctx.reg, ctx.cycle, mem)
+				&& !exec(mem.at(pc), true))
+			return is_running() ? INVALID : HALTED;
+		if(is_idle(pc))
+			return IDLE;
+	}
+	return BUDGET;
+}
+
+/*
+ * Run through the selected engine until the cycle count reaches limit
+ */
+word dcpu::run_limit(size_t limit, bool breakpoints) {
+	word reason;
+
+	if(breakpoints
+			&& !breaks.empty())
+		reason = run_breakpoints(limit);
+	else if(engine == THREADED)
+		reason = run_threaded(limit);
+	else if(engine == JIT)
+		reason = run_jit(limit);
+	else if(engine == CACHED)
+		reason = run_cached(limit);
+	else
+		reason = run_interp(limit);
+
+	// a malformed command halts the cpu
+	if(reason == INVALID)
+		halt();
+	return reason;
+}
+
+/*
+ * Run until the cycle count reaches limit (threaded dispatch,
+ * checking the limit at branches and every BLOCK_LEN commands)
+ *
+ * Register-only forms are handled inline; everything else goes through
+ * exec, so state is identical to the interpreter. GCC builds dispatch
+ * through a label table (labels-as-values), other compilers through a
+ * switch on the same handler index.
+ */
+word dcpu::run_threaded(size_t limit) {
+	word &pc = ctx.reg[R_PC], &over = ctx.reg[R_OVERFLOW];
+	const decode::op *entry;
+	word *a_reg, b_val, from, left;
+
+#if defined(__GNUC__)
+#define HANDLER(_FORM_, _CODE_) H_ ## _FORM_ ## _ ## _CODE_
+#define CASE(_FORM_, _CODE_) HANDLER(_FORM_, _CODE_):
+#define DISPATCH() goto *handler[(entry->form << dcpu::B_OP_LEN) | entry->code]
+#define GENERIC_CASE(_CODE_) CASE(0, _CODE_)
+
+	// handler for each form and opcode
+	static void *handler[decode::FORM_COUNT << B_OP_LEN] = {
+		&&H_0_NB, &&H_0_NB, &&H_0_NB, &&H_0_NB, &&H_0_NB, &&H_0_NB, &&H_0_NB, &&H_0_NB,
+		&&H_0_NB, &&H_0_NB, &&H_0_NB, &&H_0_NB, &&H_0_NB, &&H_0_NB, &&H_0_NB, &&H_0_NB,
+		&&H_0_NB, &&H_1_SET, &&H_1_ADD, &&H_1_SUB, &&H_1_MUL, &&H_1_DIV, &&H_1_MOD, &&H_1_SHL,
+		&&H_1_SHR, &&H_1_AND, &&H_1_BOR, &&H_1_XOR, &&H_1_IFE, &&H_1_IFN, &&H_1_IFG, &&H_1_IFB,
+		&&H_0_NB, &&H_2_SET, &&H_2_ADD, &&H_2_SUB, &&H_2_MUL, &&H_2_DIV, &&H_2_MOD, &&H_2_SHL,
+		&&H_2_SHR, &&H_2_AND, &&H_2_BOR, &&H_2_XOR, &&H_2_IFE, &&H_2_IFN, &&H_2_IFG, &&H_2_IFB,
+		&&H_0_NB, &&H_3_SET, &&H_0_NB, &&H_0_NB, &&H_0_NB, &&H_0_NB, &&H_0_NB, &&H_0_NB,
+		&&H_0_NB, &&H_0_NB, &&H_0_NB, &&H_0_NB, &&H_0_NB, &&H_0_NB, &&H_0_NB, &&H_0_NB,
+	};
+#else
+#define CASE(_FORM_, _CODE_) case ((_FORM_) << dcpu::B_OP_LEN) | (_CODE_):
+#define DISPATCH() goto dispatch
+#define GENERIC_CASE(_CODE_) default:
+#endif
+
+	// fetch operands of a register-only form
+#define REG_REG() a_reg = &ctx.reg[entry->a]; b_val = ctx.reg[entry->b]; ++pc;
+#define REG_LIT() a_reg = &ctx.reg[entry->a]; b_val = entry->b % LIT_COUNT; ++pc;
+
+	// register-only arithmetic handlers
+#define OP_SET() *a_reg = b_val; ctx.cycle += entry->cost; DISPATCH_NEXT();
+#define OP_ADD() { dword res = *a_reg + b_val; over = (res >= HIGH) ? FLAG : LOW; \
+		*a_reg = res; ctx.cycle += entry->cost; DISPATCH_NEXT(); }
+#define OP_SUB() over = (b_val > *a_reg) ? HIGH : LOW; *a_reg -= b_val; ctx.cycle += entry->cost; DISPATCH_NEXT();
+#define OP_MUL() over = ((*a_reg * b_val) >> 16) & HIGH; *a_reg *= b_val; ctx.cycle += entry->cost; DISPATCH_NEXT();
+#define OP_DIV() if(!b_val) { over = LOW; *a_reg = LOW; } else { over = ((*a_reg << 16) / b_val) & HIGH; \
+		*a_reg /= b_val; } ctx.cycle += entry->cost; DISPATCH_NEXT();
+#define OP_MOD() *a_reg = b_val ? (*a_reg % b_val) : LOW; ctx.cycle += entry->cost; DISPATCH_NEXT();
+#define OP_SHL() b_val &= SHIFT_MASK; over = ((*a_reg << b_val) >> 16) & HIGH; *a_reg = *a_reg << b_val; ctx.cycle += entry->cost; DISPATCH_NEXT();
+#define OP_SHR() b_val &= SHIFT_MASK; over = ((*a_reg << 16) >> b_val) & HIGH; *a_reg = *a_reg >> b_val; ctx.cycle += entry->cost; DISPATCH_NEXT();
+#define OP_AND() *a_reg &= b_val; ctx.cycle += entry->cost; DISPATCH_NEXT();
+#define OP_BOR() *a_reg |= b_val; ctx.cycle += entry->cost; DISPATCH_NEXT();
+#define OP_XOR() *a_reg ^= b_val; ctx.cycle += entry->cost; DISPATCH_NEXT();
+
+	// register-only conditionals run the next command inline when taken,
+	// skip it by length otherwise (a taken invalid command is stepped over)
+#define OP_IF(_COND_) ctx.cycle += entry->cost; from = pc - 1; \
+		if(_COND_) { \
+			if(decode::at(mem.at(pc)).code == NB \
+					&& decode::at(mem.at(pc)).a != JSR) \
+				++pc; \
+		} else { \
+			++ctx.cycle; \
+			skip(); \
+		} \
+		if(is_idle(from)) \
+			return IDLE; \
+		DISPATCH_BRANCH();
+
+	// running off the end of memory wraps back to the start, and
+	// straight-line code ends a block every BLOCK_LEN commands
+#define DISPATCH_NEXT() if(!--left) { if(ctx.cycle >= limit) return BUDGET; left = BLOCK_LEN; } \
+		if(!pc && is_idle(pc - 1)) return IDLE; \
+		entry = &decode::at(mem.at(pc)); DISPATCH();
+
+	// branches end a basic block, check the cycle limit
+#define DISPATCH_BRANCH() if(ctx.cycle >= limit) return BUDGET; left = BLOCK_LEN + 1; DISPATCH_NEXT();
+#define FORMS(_CODE_, _OP_) CASE(1, _CODE_) REG_REG() _OP_ CASE(2, _CODE_) REG_LIT() _OP_
+
+	// fetch first command
+	DISPATCH_BRANCH();
+
+#if !defined(__GNUC__)
+dispatch:
+	switch((entry->form << B_OP_LEN) | entry->code) {
+#endif
+	FORMS(SET, OP_SET())
+	FORMS(ADD, OP_ADD())
+	FORMS(SUB, OP_SUB())
+	FORMS(MUL, OP_MUL())
+	FORMS(DIV, OP_DIV())
+	FORMS(MOD, OP_MOD())
+	FORMS(SHL, OP_SHL())
+	FORMS(SHR, OP_SHR())
+	FORMS(AND, OP_AND())
+	FORMS(BOR, OP_BOR())
+	FORMS(XOR, OP_XOR())
+	FORMS(IFE, OP_IF(*a_reg == b_val))
+	FORMS(IFN, OP_IF(*a_reg != b_val))
+	FORMS(IFG, OP_IF(*a_reg > b_val))
+	FORMS(IFB, OP_IF(*a_reg & b_val))
+
+	// jump to literal
+	CASE(3, SET)
+		from = pc;
+		pc = entry->b % LIT_COUNT;
+		ctx.cycle += entry->cost;
+		if(is_idle(from))
+			return IDLE;
+		DISPATCH_BRANCH();
+
+	// any other form (may branch)
+	GENERIC_CASE(NB)
+		from = pc;
+		if(!exec(mem.at(pc), true))
+			return is_running() ? INVALID : HALTED;
+		if(is_idle(from))
+			return IDLE;
+		DISPATCH_BRANCH();
+#if !defined(__GNUC__)
+	}
+#endif
+
+#undef HANDLER
+#undef CASE
+#undef DISPATCH
+#undef GENERIC_CASE
+#undef REG_REG
+#undef REG_LIT
+#undef OP_SET
+#undef OP_ADD
+#undef OP_SUB
+#undef OP_MUL
+#undef OP_DIV
+#undef OP_MOD
+#undef OP_SHL
+#undef OP_SHR
+#undef OP_AND
+#undef OP_BOR
+#undef OP_XOR
+#undef OP_IF
+#undef DISPATCH_NEXT
+#undef DISPATCH_BRANCH
+#undef FORMS
+}
+
 /*
  * Return a system register
  */
@@ -927,18 +1405,58 @@ reg16 &dcpu::s_register(word reg) {
 }
 
 /*
- * Set a value held at a given location
+ * Set a breakpoint at an address (a run or step stops before
+ * running the command at the address, unless it starts there)
  */
-void dcpu::set_value(word location, word *ptr, word value) {
+void dcpu::set_breakpoint(word address) {
+	if(breaks.empty())
+		breaks.assign(COUNT / 32, 0);
+	breaks[address / 32] |= 1 << (address % 32);
+}
 
-	// add a cycle if writing to a memory location
-	// (not sure about this, spec doesn't specify cycles required for writes)
-	if((location >= L_VAL && location <= H_OFF)
-			|| location == ADR_OFF)
-		++cycle;
+/*
+ * Skip the command at PC, and the command after it while the skipped
+ * command is a conditional (advances PC by each command's decoded
+ * length, without reading operands)
+ */
+void dcpu::skip(void) {
+	const decode::op *entry;
+	dword count = 0;
+
+	do {
+		entry = &decode::at(mem.at(ctx.reg[R_PC]));
+		ctx.reg[R_PC] += entry->length;
+	} while(entry->code >= IFE
+			&& ++count < COUNT);
+}
 
-	// set address to value
-	*ptr = value;
+/*
+ * Return the B value of a register-only form
+ */
+template<word FORM> word dcpu::source(word value) {
+	return (FORM == decode::REG_REG) ? ctx.reg[value] : value % LIT_COUNT;
+}
+
+/*
+ * Returns if registers & memory are unchanged since the last idle
+ * sample, taking a new sample otherwise
+ *
+ * Execution depends only on registers & memory, so a cpu found in the
+ * same state twice loops forever. A write counts as a change even if
+ * it stores the value already held.
+ */
+bool dcpu::spinning(void) {
+	if(spin.taken
+			&& spin.writes == mem.writes()
+			&& !std::memcmp(spin.reg, ctx.reg, sizeof(spin.reg)))
+		return true;
+
+	// take a new sample
+	std::memcpy(spin.reg, ctx.reg, sizeof(spin.reg));
+	spin.writes = mem.writes();
+	spin.next = ctx.cycle + IDLE_WINDOW;
+	spin.taken = true;
+	return false;
 }
 
 /*
@@ -947,10 +1465,176 @@ void dcpu::set_value(word location, word *ptr, word value) {
 bool dcpu::state_change(word state) {
 
 	// check if already in state
-	if(this->state == state)
+	if(ctx.state == state)
 		return false;
 
 	// assign new state
-	this->state = state;
+	ctx.state = state;
 	return true;
 }
+
+/*
+ * Run a given number of commands, returning why it stopped
+ */
+word dcpu::step(size_t count) {
+
+	// attempt to change state (unless resuming)
+	if(!is_running())
+		state_change(RUN);
+
+	// run commands, stopping at breakpoints past the first
+	for(size_t i = 0; i < count; ++i) {
+		if(i
+				&& is_breakpoint(ctx.reg[R_PC]))
+			return BREAKPOINT;
+		if(!exec(mem.at(ctx.reg[R_PC]), true)) {
+			if(!is_running())
+				return HALTED;
+			halt();
+			return INVALID;
+		}
+	}
+	return BUDGET;
+}
+
+/*
+ * Write a value to an operand location
+ */
+template<word MODE> void dcpu::write(word *ptr, word value) {
+
+	// set address to value
+	*ptr = value;
+
+	// invalidate cached code when writing to memory
+	switch(MODE) {
+		case decode::O_VAL:
+		case decode::O_OFF:
+		case decode::O_POP:
+		case decode::O_PEEK:
+		case decode::O_PUSH:
+		case decode::O_ADR:
+		case decode::O_NEXT:
+			mem.touch(ptr - &mem.at(LOW));
+			break;
+		default:
+			break;
+	}
+}
+
+/*
+ * Handler instantiations for every B mode of an opcode and A mode
+ */
+#define MODES_B(_OP_, _A_) \
+	&dcpu::_OP_<_A_, 0>, &dcpu::_OP_<_A_, 1>, &dcpu::_OP_<_A_, 2>, &dcpu::_OP_<_A_, 3>, \
+	&dcpu::_OP_<_A_, 4>, &dcpu::_OP_<_A_, 5>, &dcpu::_OP_<_A_, 6>, &dcpu::_OP_<_A_, 7>, \
+	&dcpu::_OP_<_A_, 8>, &dcpu::_OP_<_A_, 9>, &dcpu::_OP_<_A_, 10>, &dcpu::_OP_<_A_, 11>
+
+/*
+ * Handler instantiations for every A & B mode of an opcode
+ */
+#define MODES(_OP_) \
+	MODES_B(_OP_, 0), MODES_B(_OP_, 1), MODES_B(_OP_, 2), MODES_B(_OP_, 3), \
+	MODES_B(_OP_, 4), MODES_B(_OP_, 5), MODES_B(_OP_, 6), MODES_B(_OP_, 7), \
+	MODES_B(_OP_, 8), MODES_B(_OP_, 9), MODES_B(_OP_, 10), MODES_B(_OP_, 11)
+
+/*
+ * Command handlers (opcode x A mode x B mode, non-basic opcodes
+ * select by their A value: 0 reserved, 1 JSR, 2 - 11 reserved)
+ */
+const dcpu::handler dcpu::HANDLER[decode::HANDLER_COUNT] = {
+	MODES_B(_res, 0), MODES_B(_jsr, 1), MODES_B(_res, 2), MODES_B(_res, 3),
+	MODES_B(_res, 4), MODES_B(_res, 5), MODES_B(_res, 6), MODES_B(_res, 7),
+	MODES_B(_res, 8), MODES_B(_res, 9), MODES_B(_res, 10), MODES_B(_res, 11),
+	MODES(_set), MODES(_add), MODES(_sub), MODES(_mul), MODES(_div),
+	MODES(_mod), MODES(_shl), MODES(_shr), MODES(_and), MODES(_bor),
+	MODES(_xor), MODES(_ife), MODES(_ifn), MODES(_ifg), MODES(_ifb),
+};
+
+/*
+ * Splitting handler instantiations for every B mode of a conditional and A mode
+ */
+#define SPLIT_MODES_B(_OP_, _A_) \
+	&dcpu::_OP_<_A_, 0, true>, &dcpu::_OP_<_A_, 1, true>, &dcpu::_OP_<_A_, 2, true>, \
+	&dcpu::_OP_<_A_, 3, true>, &dcpu::_OP_<_A_, 4, true>, &dcpu::_OP_<_A_, 5, true>, \
+	&dcpu::_OP_<_A_, 6, true>, &dcpu::_OP_<_A_, 7, true>, &dcpu::_OP_<_A_, 8, true>, \
+	&dcpu::_OP_<_A_, 9, true>, &dcpu::_OP_<_A_, 10, true>, &dcpu::_OP_<_A_, 11, true>
+
+/*
+ * Splitting handler instantiations for every A & B mode of a conditional
+ */
+#define SPLIT_MODES(_OP_) \
+	SPLIT_MODES_B(_OP_, 0), SPLIT_MODES_B(_OP_, 1), SPLIT_MODES_B(_OP_, 2), \
+	SPLIT_MODES_B(_OP_, 3), SPLIT_MODES_B(_OP_, 4), SPLIT_MODES_B(_OP_, 5), \
+	SPLIT_MODES_B(_OP_, 6), SPLIT_MODES_B(_OP_, 7), SPLIT_MODES_B(_OP_, 8), \
+	SPLIT_MODES_B(_OP_, 9), SPLIT_MODES_B(_OP_, 10), SPLIT_MODES_B(_OP_, 11)
+
+/*
+ * Splitting conditional handlers (laid out as the conditional command
+ * handlers, used while recording)
+ */
+const dcpu::handler dcpu::SPLIT_HANDLER[4 * decode::MODE_COUNT * decode::MODE_COUNT] = {
+	SPLIT_MODES(_ife), SPLIT_MODES(_ifn), SPLIT_MODES(_ifg), SPLIT_MODES(_ifb),
+};
+
+/*
+ * Pre-decoded handler instantiations for every B mode of an opcode and A mode
+ */
+#define LINE_MODES_B(_CODE_, _A_) \
+	&dcpu::_line<_CODE_, _A_, 0>, &dcpu::_line<_CODE_, _A_, 1>, &dcpu::_line<_CODE_, _A_, 2>, \
+	&dcpu::_line<_CODE_, _A_, 3>, &dcpu::_line<_CODE_, _A_, 4>, &dcpu::_line<_CODE_, _A_, 5>, \
+	&dcpu::_line<_CODE_, _A_, 6>, &dcpu::_line<_CODE_, _A_, 7>, &dcpu::_line<_CODE_, _A_, 8>, \
+	&dcpu::_line<_CODE_, _A_, 9>, &dcpu::_line<_CODE_, _A_, 10>, &dcpu::_line<_CODE_, _A_, 11>
+
+/*
+ * Pre-decoded handler instantiations for every A & B mode of an opcode
+ */
+#define LINE_MODES(_CODE_) \
+	LINE_MODES_B(_CODE_, 0), LINE_MODES_B(_CODE_, 1), LINE_MODES_B(_CODE_, 2), \
+	LINE_MODES_B(_CODE_, 3), LINE_MODES_B(_CODE_, 4), LINE_MODES_B(_CODE_, 5), \
+	LINE_MODES_B(_CODE_, 6), LINE_MODES_B(_CODE_, 7), LINE_MODES_B(_CODE_, 8), \
+	LINE_MODES_B(_CODE_, 9), LINE_MODES_B(_CODE_, 10), LINE_MODES_B(_CODE_, 11)
+
+/*
+ * Pre-decoded command handlers (laid out as the command handlers)
+ */
+const dcpu::line_handler dcpu::LINE_HANDLER[decode::HANDLER_COUNT] = {
+	LINE_MODES(NB), LINE_MODES(SET), LINE_MODES(ADD), LINE_MODES(SUB),
+	LINE_MODES(MUL), LINE_MODES(DIV), LINE_MODES(MOD), LINE_MODES(SHL),
+	LINE_MODES(SHR), LINE_MODES(AND), LINE_MODES(BOR), LINE_MODES(XOR),
+	LINE_MODES(IFE), LINE_MODES(IFN), LINE_MODES(IFG), LINE_MODES(IFB),
+};
+
+/*
+ * Fused conditional jump handlers (IF* opcode x form)
+ */
+const dcpu::line_handler dcpu::IF_JUMP_HANDLER[4][2] = {
+	{ &dcpu::_if_jump<IFE, decode::REG_REG>, &dcpu::_if_jump<IFE, decode::REG_LIT> },
+	{ &dcpu::_if_jump<IFN, decode::REG_REG>, &dcpu::_if_jump<IFN, decode::REG_LIT> },
+	{ &dcpu::_if_jump<IFG, decode::REG_REG>, &dcpu::_if_jump<IFG, decode::REG_LIT> },
+	{ &dcpu::_if_jump<IFB, decode::REG_REG>, &dcpu::_if_jump<IFB, decode::REG_LIT> },
+};
+
+/*
+ * Fused update & test handlers for every conditional of an opcode and form
+ */
+#define ARITH_IF(_CODE_, _FORM_) { \
+	{ &dcpu::_arith_if<_CODE_, _FORM_, IFE, decode::REG_REG>, &dcpu::_arith_if<_CODE_, _FORM_, IFE, decode::REG_LIT> }, \
+	{ &dcpu::_arith_if<_CODE_, _FORM_, IFN, decode::REG_REG>, &dcpu::_arith_if<_CODE_, _FORM_, IFN, decode::REG_LIT> }, \
+	{ &dcpu::_arith_if<_CODE_, _FORM_, IFG, decode::REG_REG>, &dcpu::_arith_if<_CODE_, _FORM_, IFG, decode::REG_LIT> }, \
+	{ &dcpu::_arith_if<_CODE_, _FORM_, IFB, decode::REG_REG>, &dcpu::_arith_if<_CODE_, _FORM_, IFB, decode::REG_LIT> } }
+
+/*
+ * Fused update & test handlers (ADD | SUB x form x IF* opcode x form)
+ */
+const dcpu::line_handler dcpu::ARITH_IF_HANDLER[2][2][4][2] = {
+	{ ARITH_IF(ADD, decode::REG_REG), ARITH_IF(ADD, decode::REG_LIT) },
+	{ ARITH_IF(SUB, decode::REG_REG), ARITH_IF(SUB, decode::REG_LIT) },
+};
+
+#undef ARITH_IF
+#undef LINE_MODES
+#undef LINE_MODES_B
+#undef MODES
+#undef MODES_B
+#undef SPLIT_MODES
+#undef SPLIT_MODES_B
@@ -22,10 +22,13 @@
 
 #include <string>
 #include <vector>
+#include "decode.hpp"
 #include "mem128.hpp"
 #include "reg16.hpp"
 #include "types.hpp"
 
+class jit;
+
 class dcpu {
 public:
 
@@ -39,11 +42,32 @@ public:
 	 */
 	static const word S_REG_COUNT = 0x03;
 
+	/*
+	 * Flat register count (A - J, SP, PC, OVERFLOW)
+	 */
+	static const word REG_COUNT = M_REG_COUNT + S_REG_COUNT;
+
 	/*
 	 * Literal count
 	 */
 	static const word LIT_COUNT = 0x20;
 
+	/*
+	 * Shift count mask (counts wrap at 32, as on x86 hosts)
+	 */
+	static const word SHIFT_MASK = 0x1F;
+
+	/*
+	 * Cycles between idle loop samples
+	 */
+	static const size_t IDLE_WINDOW = 0x100;
+
+	/*
+	 * Commands the threaded engine runs between cycle limit checks
+	 * (ends blocks of straight-line code)
+	 */
+	static const word BLOCK_LEN = 0x40;
+
 	/*
 	 * Basic opcode section lengths
 	 *
@@ -67,15 +91,44 @@ public:
 	static const word NB_OP_LEN = 0x06;
 	static const word INPUT_LEN = 0x06;
 
+	/*
+	 * Flat cpu state (fits in a single cache line)
+	 */
+	typedef struct alignas(16) {
+		word reg[REG_COUNT];
+		word state;
+		size_t cycle;
+	} context;
+
 private:
 
 	/*
-	 * Main registers (A - J)
+	 * Lockstep engine (runs lanes through exec)
+	 */
+	friend class lockstep;
+
+	/*
+	 * Snapshots (copy execution state & memory)
+	 */
+	friend class snapshot;
+
+	/*
+	 * Tracer (reads registers after each command)
+	 */
+	friend class tracer;
+
+	/*
+	 * Execution state (registers, state & cycle)
+	 */
+	context ctx;
+
+	/*
+	 * Main register views (A - J)
 	 */
 	reg16 m_reg[M_REG_COUNT];
 
 	/*
-	 * System registers (PC - Overflow)
+	 * System register views (PC - Overflow)
 	 */
 	reg16 s_reg[S_REG_COUNT];
 
@@ -85,94 +138,238 @@ private:
 	mem128 mem;
 
 	/*
-	 * Current state
+	 * Execution engine
+	 */
+	word engine;
+
+	/*
+	 * Native translator (created on first native run, not copied)
+	 */
+	jit *compiler;
+
+	/*
+	 * Breakpoint addresses (one bit per address, empty if none are set)
 	 */
-	word state;
+	std::vector<dword> breaks;
 
 	/*
-	 * Current cycle
+	 * Idle loop sample (registers & memory write count when taken,
+	 * the cycle of the next sample)
 	 */
-	size_t cycle;
+	typedef struct {
+		bool taken;
+		word reg[REG_COUNT];
+		size_t writes;
+		size_t next;
+	} sample;
+
+	/*
+	 * Last idle loop sample (not copied)
+	 */
+	sample spin;
+
+	/*
+	 * Command handler
+	 */
+	typedef bool (dcpu::*handler)(const decode::op &entry, bool exe);
+
+	/*
+	 * Command handlers (opcode x A mode x B mode)
+	 */
+	static const handler HANDLER[decode::HANDLER_COUNT];
+
+	/*
+	 * Splitting conditional handlers (IF* opcode x A mode x B mode)
+	 */
+	static const handler SPLIT_HANDLER[4 * decode::MODE_COUNT * decode::MODE_COUNT];
+
+	/*
+	 * Pre-decoded command
+	 */
+	struct line;
+
+	/*
+	 * Pre-decoded command handler
+	 */
+	typedef bool (dcpu::*line_handler)(const line &cached);
+
+	/*
+	 * Pre-decoded command
+	 *
+	 * func:	handler resolved for the opcode and operand modes
+	 *		(or for a superinstruction)
+	 * entry:	decoded command
+	 * second:	decoded command fused after it (if any)
+	 * version:	versions of the pages holding the first and last word
+	 * next:	operand next words, in the order they are read
+	 *		(the target of a fused jump)
+	 * last:	address of the last word (of the second command if fused)
+	 */
+	struct line {
+		line_handler func;
+		const decode::op *entry;
+		const decode::op *second;
+		dword version[2];
+		word next[2];
+		word last;
+	};
+
+	/*
+	 * Pre-decoded command handlers (opcode x A mode x B mode)
+	 */
+	static const line_handler LINE_HANDLER[decode::HANDLER_COUNT];
+
+	/*
+	 * Fused conditional jump handlers (IF* opcode x form)
+	 */
+	static const line_handler IF_JUMP_HANDLER[4][2];
+
+	/*
+	 * Fused update & test handlers (ADD | SUB x form x IF* opcode x form)
+	 */
+	static const line_handler ARITH_IF_HANDLER[2][2][4][2];
+
+	/*
+	 * Superinstruction hit counts
+	 */
+	size_t hits[decode::FUSE_COUNT];
+
+	/*
+	 * Pre-decoded commands by address (allocated on first cached run,
+	 * not copied)
+	 */
+	std::vector<line> lines;
 
 	/*
 	 * Add B to A (sets overflow)
 	 */
-	void _add(word a, word b, bool exe);
+	template<word A_MODE, word B_MODE> bool _add(const decode::op &entry, bool exe);
 
 	/*
 	 * Binary AND of A and B
 	 */
-	void _and(word a, word b, bool exe);
+	template<word A_MODE, word B_MODE> bool _and(const decode::op &entry, bool exe);
 
 	/*
 	 * Binary OR of A and B
 	 */
-	void _bor(word a, word b, bool exe);
+	template<word A_MODE, word B_MODE> bool _bor(const decode::op &entry, bool exe);
 
 	/*
 	 * Division of A by B (sets overflow)
 	 */
-	void _div(word a, word b, bool exe);
+	template<word A_MODE, word B_MODE> bool _div(const decode::op &entry, bool exe);
 
 	/*
 	 * Execute next instruction if ((A & B) != 0)
 	 */
-	void _ifb(word a, word b, bool exe);
+	template<word A_MODE, word B_MODE, bool SPLIT = false> bool _ifb(const decode::op &entry, bool exe);
 
 	/*
 	 * Execute next instruction if (A == B)
 	 */
-	void _ife(word a, word b, bool exe);
+	template<word A_MODE, word B_MODE, bool SPLIT = false> bool _ife(const decode::op &entry, bool exe);
 
 	/*
 	 * Execute next instruction if (A > B)
 	 */
-	void _ifg(word a, word b, bool exe);
+	template<word A_MODE, word B_MODE, bool SPLIT = false> bool _ifg(const decode::op &entry, bool exe);
 
 	/*
 	 * Execute next instruction if (A != B)
 	 */
-	void _ifn(word a, word b, bool exe);
+	template<word A_MODE, word B_MODE, bool SPLIT = false> bool _ifn(const decode::op &entry, bool exe);
 
 	/*
 	 * Push the address of the next word onto the stack
 	 */
-	void _jsr(word a, bool exe);
+	template<word A_MODE, word B_MODE> bool _jsr(const decode::op &entry, bool exe);
 
 	/*
 	 * Modulus of A by B
 	 */
-	void _mod(word a, word b, bool exe);
+	template<word A_MODE, word B_MODE> bool _mod(const decode::op &entry, bool exe);
 
 	/*
 	 * Multiplication of B from A (sets overflow)
 	 */
-	void _mul(word a, word b, bool exe);
+	template<word A_MODE, word B_MODE> bool _mul(const decode::op &entry, bool exe);
+
+	/*
+	 * Reserved non-basic opcode (invalid)
+	 */
+	template<word A_MODE, word B_MODE> bool _res(const decode::op &entry, bool exe);
 
 	/*
 	 * Set A to B
 	 */
-	void _set(word a, word b, bool exe);
+	template<word A_MODE, word B_MODE> bool _set(const decode::op &entry, bool exe);
 
 	/*
 	 * Shift-left A by B (sets overflow)
 	 */
-	void _shl(word a, word b, bool exe);
+	template<word A_MODE, word B_MODE> bool _shl(const decode::op &entry, bool exe);
 
 	/*
 	 * Shift-right A by B (sets overflow)
 	 */
-	void _shr(word a, word b, bool exe);
+	template<word A_MODE, word B_MODE> bool _shr(const decode::op &entry, bool exe);
 
 	/*
 	 * Subtraction of B from A (sets overflow)
 	 */
-	void _sub(word a, word b, bool exe);
+	template<word A_MODE, word B_MODE> bool _sub(const decode::op &entry, bool exe);
 
 	/*
 	 * Exclusive-OR of A and B
 	 */
-	void _xor(word a, word b, bool exe);
+	template<word A_MODE, word B_MODE> bool _xor(const decode::op &entry, bool exe);
+
+	/*
+	 * Run the next instruction if a condition holds (or leave it to run
+	 * as its own step when splitting), skip it otherwise
+	 */
+	template<bool SPLIT> void _if(const decode::op &entry, bool exe, bool cond);
+
+	/*
+	 * Fused ADD | SUB followed by a conditional
+	 */
+	template<word CODE, word FORM, word IF_CODE, word IF_FORM> bool _arith_if(const line &cached);
+
+	/*
+	 * Fused conditional followed by a jump
+	 */
+	template<word CODE, word FORM> bool _if_jump(const line &cached);
+
+	/*
+	 * Fused JSR to a literal target
+	 */
+	bool _jsr_lit(const line &cached);
+
+	/*
+	 * Run a pre-decoded command (next words are taken from the line)
+	 */
+	template<word CODE, word A_MODE, word B_MODE> bool _line(const line &cached);
+
+	/*
+	 * Fused pair of register pops
+	 */
+	bool _pop_pair(const line &cached);
+
+	/*
+	 * Fused pair of register pushes
+	 */
+	bool _push_pair(const line &cached);
+
+	/*
+	 * Bind register views to the execution state
+	 */
+	void bind(void);
+
+	/*
+	 * Returns if a conditional opcode holds for two values
+	 */
+	template<word CODE> static bool condition(word a_val, word b_val);
 
 	/*
 	 * Execute a single command
@@ -190,25 +387,105 @@ private:
 	bool exec(word offset, word range, std::vector<word> &op);
 
 	/*
-	 * Return an address of a value at a given location
+	 * Execute a single command, leaving the command a passing IF*
+	 * guards to run as its own step
+	 */
+	bool exec_split(word op);
+
+	/*
+	 * Pre-decode the command at an address into its line
+	 */
+	line &fill(word address);
+
+	/*
+	 * Returns if a jump back from an address made no progress since the
+	 * last idle sample (sampled at most once per IDLE_WINDOW cycles)
+	 */
+	bool is_idle(word from) {
+		return ctx.reg[R_PC] <= from
+				&& ctx.cycle >= spin.next
+				&& spinning();
+	}
+
+	/*
+	 * Return the location of an operand, reading next words and
+	 * adjusting SP as needed (literals are copied into literal)
+	 */
+	template<word MODE> word *operand(word value, word &literal);
+
+	/*
+	 * Return the location of an operand, taking next words from a line
+	 * and adjusting SP as needed (literals are copied into literal)
+	 */
+	template<word MODE> word *operand(word value, const word *&next, word &literal);
+
+	/*
+	 * Run until the cycle count reaches limit, stopping at breakpoints
+	 * past the first command (one command at a time)
+	 */
+	word run_breakpoints(size_t limit);
+
+	/*
+	 * Run until the cycle count reaches limit (pre-decoded commands,
+	 * one at a time)
+	 */
+	word run_cached(size_t limit);
+
+	/*
+	 * Run until the cycle count reaches limit (one command at a time)
+	 */
+	word run_interp(size_t limit);
+
+	/*
+	 * Run until the cycle count reaches limit (one command at a time),
+	 * recording each command to a profiler policy
+	 */
+	template<class PROFILER> word run_interp(size_t limit, PROFILER &prof);
+
+	/*
+	 * Run until the cycle count reaches limit (native basic blocks,
+	 * checking the limit between blocks)
+	 */
+	word run_jit(size_t limit);
+
+	/*
+	 * Run until the cycle count reaches limit (threaded dispatch,
+	 * checking the limit at branches)
+	 */
+	word run_threaded(size_t limit);
+
+	/*
+	 * Run through the selected engine until the cycle count reaches limit
 	 */
-	word *get_address(word value, bool exe);
+	word run_limit(size_t limit, bool breakpoints);
 
 	/*
-	 * Return a value held at a given value
+	 * Skip the command at PC, and the command after it while the skipped
+	 * command is a conditional
 	 */
-	word get_value(word value, bool exe);
+	void skip(void);
 
 	/*
-	 * Set a value held at a given location
+	 * Return the B value of a register-only form
 	 */
-	void set_value(word location, word *ptr, word value);
+	template<word FORM> word source(word value);
+
+	/*
+	 * Returns if registers & memory are unchanged since the last idle
+	 * sample, taking a new sample otherwise
+	 */
+	bool spinning(void);
 
 	/*
 	 * Perform a state change
 	 */
 	bool state_change(word state);
 
+	/*
+	 * Write a value to an operand location
+	 */
+	template<word MODE> void write(word *ptr, word value);
+
 public:
 
 	/*
@@ -221,6 +498,11 @@ public:
 	 */
 	enum S_REG { SP, PC, OVERFLOW };
 
+	/*
+	 * Flat register offsets
+	 */
+	enum REG { R_A, R_B, R_C, R_X, R_Y, R_Z, R_I, R_J, R_SP, R_PC, R_OVERFLOW };
+
 	/*
 	 * Supported basic opcodes
 	 */
@@ -237,6 +519,17 @@ public:
 	 */
 	enum STATE { INIT, RUN, HALT };
 
+	/*
+	 * Execution engines
+	 */
+	enum ENGINE { INTERP, THREADED, JIT, CACHED };
+
+	/*
+	 * Stop reasons (halted, cycle or command budget spent, invalid
+	 * command, breakpoint reached, idle loop reached)
+	 */
+	enum STOP { HALTED, BUDGET, INVALID, BREAKPOINT, IDLE };
+
 	/*
 	 * Values types
 	 */
@@ -254,6 +547,11 @@ public:
 	 */
 	dcpu(const dcpu &other);
 
+	/*
+	 * Cpu constructor
+	 */
+	dcpu(word engine);
+
 	/*
 	 * Cpu constructor
 	 */
@@ -295,15 +593,28 @@ public:
 	std::string dump(void);
 
 	/*
-	 * Dump cpu to file at a givne path
+	 * Dump cpu to file at a givne path (registers, then memory if requested)
+	 */
+	bool dump_to_file(const std::string &path, bool memory = false);
+
+	/*
+	 * Return how often a superinstruction ran on the cached engine
 	 */
-	bool dump_to_file(const std::string &path);
+	size_t fused(word kind);
 
 	/*
 	 * Halt a Cpu
 	 */
 	bool halt(void);
 
+	/*
+	 * Returns if a breakpoint is set at an address
+	 */
+	bool is_breakpoint(word address) {
+		return !breaks.empty()
+				&& (breaks[address / 32] & (1 << (address % 32)));
+	}
+
 	/*
 	 * Returns a Cpu running status
 	 */
@@ -319,16 +630,56 @@ public:
 	 */
 	mem128 &memory(void);
 
+	/*
+	 * Remove a breakpoint at an address
+	 */
+	void remove_breakpoint(word address);
+
+	/*
+	 * Remove all breakpoints
+	 */
+	void remove_breakpoints(void);
+
 	/*
 	 * Reset cpu
 	 */
 	void reset(void);
 
 	/*
-	 * Run a Cpu
+	 * Run a Cpu (ignoring breakpoints, halting at an idle loop)
 	 */
 	bool run(void);
 
+	/*
+	 * Run a Cpu for a budget of cycles, returning why it stopped
+	 * (the budget is checked between basic blocks, so a run may end
+	 * up to one block past it; a Cpu stopped by its budget, a
+	 * breakpoint or an idle loop is left running and may be resumed)
+	 *
+	 * A loop that leaves registers & memory unchanged across an
+	 * iteration, such as SUB PC, 1, stops the run as IDLE a few
+	 * iterations in; the cycle it stops at depends on the engine.
+	 */
+	word run(size_t budget);
+
+	/*
+	 * Run a Cpu for a budget of cycles through the interpreter,
+	 * recording each command to a profiler or tracer (ignoring
+	 * breakpoints)
+	 */
+	template<class PROFILER> word run(size_t budget, PROFILER &prof);
+
+	/*
+	 * Set a breakpoint at an address (a run or step stops before
+	 * running the command at the address, unless it starts there)
+	 */
+	void set_breakpoint(word address);
+
+	/*
+	 * Run a given number of commands, returning why it stopped
+	 */
+	word step(size_t count = 1);
+
 	/*
 	 * Return a system register
 	 */
@@ -0,0 +1,216 @@
+/*
+ * decode.cpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dcpu.hpp"
+#include "decode.hpp"
+
+/*
+ * Decoded instructions (one per opcode word)
+ */
+decode::op decode::table[COUNT];
+
+/*
+ * Build the decode table before main runs
+ */
+static const bool built = decode::build();
+
+/*
+ * Build the decode table
+ */
+bool decode::build(void) {
+
+	// decode every possible opcode word
+	for(dword i = 0; i < COUNT; ++i) {
+		op &entry = table[i];
+
+		// split opcode, A & B
+		entry.code = i & ((1 << dcpu::B_OP_LEN) - 1);
+		entry.a = (i >> dcpu::B_OP_LEN) & ((1 << dcpu::INPUT_LEN) - 1);
+		entry.b = (i >> (dcpu::B_OP_LEN + dcpu::INPUT_LEN)) & ((1 << dcpu::INPUT_LEN) - 1);
+		entry.length = 1;
+		entry.cost = 0;
+		entry.form = GENERIC;
+
+		// non-basic opcodes only take a single operand
+		if(entry.code == dcpu::NB) {
+			entry.handler = mode(entry.b);
+			if(entry.a == dcpu::JSR) {
+				entry.length += operand_next(entry.b);
+				entry.cost = operand_cost(entry.b) + 2;
+				entry.handler += MODE_COUNT;
+			}
+			continue;
+		}
+		entry.handler = (((entry.code * MODE_COUNT) + mode(entry.a)) * MODE_COUNT) + mode(entry.b);
+		entry.length += operand_next(entry.a) + operand_next(entry.b);
+
+		// assign base cost (A is read twice by read-modify-write opcodes)
+		switch(entry.code) {
+			case dcpu::SET:
+				entry.cost = operand_cost(entry.a) + operand_cost(entry.b) + write_cost(entry.a) + 1;
+				break;
+			case dcpu::ADD:
+			case dcpu::SUB:
+			case dcpu::MUL:
+			case dcpu::SHL:
+			case dcpu::SHR:
+				entry.cost = (2 * operand_cost(entry.a)) + operand_cost(entry.b) + write_cost(entry.a) + 2;
+				break;
+			case dcpu::DIV:
+			case dcpu::MOD:
+				entry.cost = (2 * operand_cost(entry.a)) + operand_cost(entry.b) + write_cost(entry.a) + 3;
+				break;
+			case dcpu::AND:
+			case dcpu::BOR:
+			case dcpu::XOR:
+				entry.cost = (2 * operand_cost(entry.a)) + operand_cost(entry.b) + write_cost(entry.a) + 1;
+				break;
+			case dcpu::IFE:
+			case dcpu::IFN:
+			case dcpu::IFG:
+			case dcpu::IFB:
+				entry.cost = operand_cost(entry.a) + operand_cost(entry.b) + 2;
+				break;
+			default:
+				break;
+		}
+
+		// assign form
+		if(entry.a <= dcpu::H_REG) {
+			if(entry.b <= dcpu::H_REG)
+				entry.form = REG_REG;
+			else if(entry.b >= dcpu::L_LIT)
+				entry.form = REG_LIT;
+		} else if(entry.code == dcpu::SET
+				&& entry.a == dcpu::PC_VAL
+				&& entry.b >= dcpu::L_LIT)
+			entry.form = PC_LIT;
+	}
+	return true;
+}
+
+/*
+ * Return the superinstruction formed by a command and the command
+ * after it (F_JSR does not consume the second command)
+ */
+halfword decode::fuse(const op &first, const op &second) {
+	bool first_reg = first.form == REG_REG || first.form == REG_LIT,
+			second_reg = second.form == REG_REG || second.form == REG_LIT;
+
+	// jump to a literal target
+	if(first.code == dcpu::NB)
+		return (first.a == dcpu::JSR
+				&& (first.b >= dcpu::L_LIT || first.b == dcpu::LIT_OFF)) ? F_JSR : F_NONE;
+
+	switch(first.code) {
+
+		// conditional jump
+		case dcpu::IFE:
+		case dcpu::IFN:
+		case dcpu::IFG:
+		case dcpu::IFB:
+			if(first_reg
+					&& second.code == dcpu::SET
+					&& second.a == dcpu::PC_VAL
+					&& (second.b >= dcpu::L_LIT || second.b == dcpu::LIT_OFF))
+				return F_IF_JUMP;
+			break;
+
+		// register save & restore
+		case dcpu::SET:
+			if(second.code == dcpu::SET
+					&& first.a == dcpu::PUSH && first.b <= dcpu::H_REG
+					&& second.a == dcpu::PUSH && second.b <= dcpu::H_REG)
+				return F_PUSH;
+			if(second.code == dcpu::SET
+					&& first.a <= dcpu::H_REG && first.b == dcpu::POP
+					&& second.a <= dcpu::H_REG && second.b == dcpu::POP)
+				return F_POP;
+			break;
+
+		// counter update & test
+		case dcpu::ADD:
+		case dcpu::SUB:
+			if(first_reg
+					&& second_reg
+					&& second.code >= dcpu::IFE)
+				return F_ARITH_IF;
+			break;
+		default:
+			break;
+	}
+	return F_NONE;
+}
+
+/*
+ * Return the cycle cost of reading an operand
+ */
+halfword decode::operand_cost(word value) {
+
+	// address offset operands read the next word and memory
+	if((value >= dcpu::L_OFF && value <= dcpu::H_OFF)
+			|| value == dcpu::ADR_OFF)
+		return 2;
+
+	// system registers and literals are free
+	else if((value >= dcpu::SP_VAL && value <= dcpu::OVER_F)
+			|| value >= dcpu::L_LIT)
+		return 0;
+	return 1;
+}
+
+/*
+ * Return the mode of an operand
+ */
+halfword decode::mode(word value) {
+
+	// register ranges
+	if(value <= dcpu::H_REG)
+		return O_REG;
+	else if(value <= dcpu::H_VAL)
+		return O_VAL;
+	else if(value <= dcpu::H_OFF)
+		return O_OFF;
+	else if(value >= dcpu::L_LIT)
+		return O_LIT;
+
+	// single values (POP - LIT_OFF)
+	return O_POP + (value - dcpu::POP);
+}
+
+/*
+ * Return if an operand reads a next word
+ */
+bool decode::operand_next(word value) {
+	return (value >= dcpu::L_OFF && value <= dcpu::H_OFF)
+			|| value == dcpu::ADR_OFF
+			|| value == dcpu::LIT_OFF;
+}
+
+/*
+ * Return the cycle cost of writing an operand
+ */
+halfword decode::write_cost(word value) {
+
+	// writes to memory locations cost a cycle
+	if((value >= dcpu::L_VAL && value <= dcpu::H_OFF)
+			|| value == dcpu::ADR_OFF)
+		return 1;
+	return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ * decode.hpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DECODE_HPP_
+#define DECODE_HPP_
+
+#include "types.hpp"
+
+class decode {
+public:
+
+	/*
+	 * Decoded instruction
+	 *
+	 * code:	basic opcode (0x00 - 0x0F)
+	 * a:		A operand (non-basic opcode for code 0x00)
+	 * b:		B operand (A operand for code 0x00)
+	 * length:	instruction length in words (1 - 3)
+	 * cost:	cycles charged when executed (excluding a failed IF* penalty)
+	 * form:	operand form used for dispatch by the threaded engine
+	 * handler:	handler index (opcode x A mode x B mode)
+	 */
+	typedef struct {
+		halfword code;
+		halfword a;
+		halfword b;
+		halfword length;
+		halfword cost;
+		halfword form;
+		word handler;
+	} op;
+
+	/*
+	 * Operand modes
+	 *
+	 * O_REG:	register
+	 * O_VAL:	[register]
+	 * O_OFF:	[next word + register]
+	 * O_POP:	[SP++]
+	 * O_PEEK:	[SP]
+	 * O_PUSH:	[--SP]
+	 * O_SP:	SP
+	 * O_PC:	PC
+	 * O_OVER:	OVERFLOW
+	 * O_ADR:	[next word]
+	 * O_NEXT:	next word
+	 * O_LIT:	literal (0 - 31)
+	 */
+	enum MODE { O_REG, O_VAL, O_OFF, O_POP, O_PEEK, O_PUSH, O_SP, O_PC, O_OVER,
+		O_ADR, O_NEXT, O_LIT };
+
+	/*
+	 * Mode count
+	 */
+	static const word MODE_COUNT = 0x0C;
+
+	/*
+	 * Handler count
+	 *
+	 * Non-basic opcodes use the A mode slot for the opcode:
+	 * slot 0 is reserved (invalid), slot 1 is JSR.
+	 */
+	static const word HANDLER_COUNT = 0x10 * MODE_COUNT * MODE_COUNT;
+
+	/*
+	 * Operand forms
+	 *
+	 * GENERIC:	any operands (handled by dcpu::exec)
+	 * REG_REG:	register A, register B
+	 * REG_LIT:	register A, literal B
+	 * PC_LIT:	PC A, literal B (SET only)
+	 */
+	enum FORM { GENERIC, REG_REG, REG_LIT, PC_LIT };
+
+	/*
+	 * Form count
+	 */
+	static const word FORM_COUNT = 0x04;
+
+	/*
+	 * Superinstructions (commands fused with the command after them)
+	 *
+	 * F_NONE:	not fused
+	 * F_IF_JUMP:	IF* register, register | literal
+	 *		followed by SET PC, literal | next word
+	 * F_PUSH:	SET PUSH, register followed by SET PUSH, register
+	 * F_POP:	SET register, POP followed by SET register, POP
+	 * F_ARITH_IF:	ADD | SUB register, register | literal
+	 *		followed by IF* register, register | literal
+	 * F_JSR:	JSR literal | next word (fused alone)
+	 */
+	enum FUSE { F_NONE, F_IF_JUMP, F_PUSH, F_POP, F_ARITH_IF, F_JSR };
+
+	/*
+	 * Superinstruction count
+	 */
+	static const word FUSE_COUNT = 0x06;
+
+	/*
+	 * Return a decoded instruction for a given opcode word
+	 */
+	static const op &at(word value) {
+		return table[value];
+	}
+
+	/*
+	 * Build the decode table
+	 */
+	static bool build(void);
+
+	/*
+	 * Return the superinstruction formed by a command and the command
+	 * after it (F_JSR does not consume the second command)
+	 */
+	static halfword fuse(const op &first, const op &second);
+
+	/*
+	 * Return the cycle cost of reading an operand
+	 */
+	static halfword operand_cost(word value);
+
+	/*
+	 * Return the mode of an operand
+	 */
+	static halfword mode(word value);
+
+	/*
+	 * Return if an operand reads a next word
+	 */
+	static bool operand_next(word value);
+
+	/*
+	 * Return the cycle cost of writing an operand
+	 */
+	static halfword write_cost(word value);
+
+private:
+
+	/*
+	 * Decoded instructions (one per opcode word)
+	 */
+	static op table[COUNT];
+};
+
+#endif
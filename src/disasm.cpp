@@ -0,0 +1,110 @@
+/*
+ * disasm.cpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include "decode.hpp"
+#include "disasm.hpp"
+
+/*
+ * Basic opcode names
+ */
+static const char *B_OP_NAME[] = {
+	"", "SET", "ADD", "SUB", "MUL", "DIV", "MOD", "SHL",
+	"SHR", "AND", "BOR", "XOR", "IFE", "IFN", "IFG", "IFB",
+};
+
+/*
+ * Register names
+ */
+static const char *REG_NAME[] = {
+	"A", "B", "C", "X", "Y", "Z", "I", "J",
+};
+
+/*
+ * Disassemble the command at an address, setting its length in words
+ */
+std::string disasm::at(mem128 &mem, word address, word &length) {
+	word value = mem.at(address), next = address + 1;
+	const decode::op &entry = decode::at(value);
+	char buf[0x10];
+
+	// reserved non-basic opcodes are shown as data
+	length = entry.length;
+	if(!entry.code
+			&& entry.a != 0x01) {
+		length = 1;
+		std::snprintf(buf, sizeof(buf), "DAT 0x%04X", value);
+		return buf;
+	}
+
+	// JSR A
+	if(!entry.code)
+		return "JSR " + operand(mem, entry.b, next);
+
+	// OP A, B (A's next word comes first)
+	std::string a = operand(mem, entry.a, next);
+	return std::string(B_OP_NAME[entry.code]) + " " + a + ", " + operand(mem, entry.b, next);
+}
+
+/*
+ * Disassemble the command at an address
+ */
+std::string disasm::at(mem128 &mem, word address) {
+	word length;
+
+	return at(mem, address, length);
+}
+
+/*
+ * Disassemble an operand, reading a next word at next if it uses one
+ */
+std::string disasm::operand(mem128 &mem, word value, word &next) {
+	char buf[0x10];
+
+	switch(decode::mode(value)) {
+		case decode::O_REG:
+			return REG_NAME[value % 8];
+		case decode::O_VAL:
+			return std::string("[") + REG_NAME[value % 8] + "]";
+		case decode::O_OFF:
+			std::snprintf(buf, sizeof(buf), "[0x%04X+%s]", mem.at(next++), REG_NAME[value % 8]);
+			return buf;
+		case decode::O_POP:
+			return "POP";
+		case decode::O_PEEK:
+			return "PEEK";
+		case decode::O_PUSH:
+			return "PUSH";
+		case decode::O_SP:
+			return "SP";
+		case decode::O_PC:
+			return "PC";
+		case decode::O_OVER:
+			return "O";
+		case decode::O_ADR:
+			std::snprintf(buf, sizeof(buf), "[0x%04X]", mem.at(next++));
+			return buf;
+		case decode::O_NEXT:
+			std::snprintf(buf, sizeof(buf), "0x%04X", mem.at(next++));
+			return buf;
+		default:
+			std::snprintf(buf, sizeof(buf), "0x%02X", value % 0x20);
+			return buf;
+	}
+}
@@ -0,0 +1,48 @@
+/*
+ * disasm.hpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DISASM_HPP_
+#define DISASM_HPP_
+
+#include <string>
+#include "mem128.hpp"
+#include "types.hpp"
+
+class disasm {
+public:
+
+	/*
+	 * Disassemble the command at an address, setting its length in words
+	 */
+	static std::string at(mem128 &mem, word address, word &length);
+
+	/*
+	 * Disassemble the command at an address
+	 */
+	static std::string at(mem128 &mem, word address);
+
+private:
+
+	/*
+	 * Disassemble an operand, reading a next word at next if it uses one
+	 */
+	static std::string operand(mem128 &mem, word value, word &next);
+};
+
+#endif
@@ -0,0 +1,513 @@
+/*
+ * jit.cpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include "dcpu.hpp"
+#include "decode.hpp"
+#include "jit.hpp"
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define JIT_X86_64
+#include <sys/mman.h>
+#endif
+
+/*
+ * Host registers
+ *
+ * A - J live in r8d - r15d, OVERFLOW in ebx, eax/ecx are scratch,
+ * rdi holds the flat register file and rsi the cycle counter
+ */
+enum HOST { EAX, ECX, EDX, EBX, ESP, EBP, ESI, EDI, R8 };
+
+/*
+ * Maximum bytes emitted for a single block
+ */
+static const size_t BLOCK_BYTES = 0x2000;
+
+/*
+ * Return the host register holding a main register
+ */
+static halfword host(word reg) {
+	return R8 + reg;
+}
+
+/*
+ * Jit constructor
+ */
+jit::jit(void) : buffer(NULL), used(0), blocks(COUNT, (block *) NULL) {
+#ifdef JIT_X86_64
+	void *mapped = mmap(NULL, BUFFER_LEN, PROT_READ | PROT_WRITE | PROT_EXEC,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(mapped != MAP_FAILED)
+		buffer = (halfword *) mapped;
+#endif
+}
+
+/*
+ * Jit destructor
+ */
+jit::~jit(void) {
+	flush();
+#ifdef JIT_X86_64
+	if(buffer)
+		munmap(buffer, BUFFER_LEN);
+#endif
+}
+
+/*
+ * Returns if native translation is available on this host
+ */
+bool jit::available(void) {
+	return buffer != NULL;
+}
+
+/*
+ * Run the block starting at PC, translating it if needed
+ * (returns false if no block could be translated at PC)
+ */
+bool jit::exec(word (&reg)[dcpu::REG_COUNT], size_t &cycle, mem128 &mem) {
+	word pc = reg[dcpu::R_PC];
+	block *blk = blocks[pc];
+
+	// retranslate blocks whose pages were written since translation
+	if(blk && (mem.page_version(pc) != blk->version[0]
+			|| mem.page_version(blk->last) != blk->version[1])) {
+		delete blk;
+		blk = blocks[pc] = NULL;
+	}
+
+	// translate block
+	if(!blk) {
+		blk = translate(pc, mem);
+		if(!blk)
+			return false;
+		blocks[pc] = blk;
+	}
+
+	// untranslatable instruction at PC
+	if(!blk->func)
+		return false;
+	blk->func(reg, &cycle);
+	return true;
+}
+
+/*
+ * Discard all translated blocks
+ */
+void jit::flush(void) {
+
+	// free all blocks
+	for(dword i = 0; i < COUNT; ++i) {
+		delete blocks[i];
+		blocks[i] = NULL;
+	}
+	used = 0;
+}
+
+/*
+ * Emit a single byte
+ */
+void jit::emit(halfword value) {
+	buffer[used++] = value;
+}
+
+/*
+ * Emit a 16-bit immediate
+ */
+void jit::emit16(word value) {
+	emit(value & 0xFF);
+	emit(value >> 8);
+}
+
+/*
+ * Emit a 32-bit immediate
+ */
+void jit::emit32(dword value) {
+	emit16(value & HIGH);
+	emit16(value >> 16);
+}
+
+/*
+ * Patch a 32-bit relative jump to target the current offset
+ */
+void jit::patch(size_t offset) {
+	dword rel = used - (offset + sizeof(dword));
+	memcpy(&buffer[offset], &rel, sizeof(dword));
+}
+
+/*
+ * Emit a register-to-register instruction (REX prefix, opcode, ModRM)
+ */
+void jit::emit_rr(halfword op, halfword reg, halfword rm, bool ext) {
+
+	// REX.R & REX.B for extended registers
+	if(reg >= R8 || rm >= R8)
+		emit(0x40 | ((reg >= R8) << 2) | (rm >= R8));
+	if(ext)
+		emit(0x0F);
+	emit(op);
+	emit(0xC0 | ((reg & 0x7) << 3) | (rm & 0x7));
+}
+
+/*
+ * Emit an instruction with an immediate (REX prefix, opcode, ModRM)
+ */
+void jit::emit_ri(halfword op, halfword ext, halfword rm, dword value, bool imm8) {
+
+	// REX.B for extended registers
+	if(rm >= R8)
+		emit(0x41);
+	emit(op);
+	emit(0xC0 | (ext << 3) | (rm & 0x7));
+	if(imm8)
+		emit(value);
+	else
+		emit32(value);
+}
+
+/*
+ * Emit a block exit setting PC and adding cycles
+ */
+void jit::emit_exit(const bool (&live)[dcpu::REG_COUNT], word pc, size_t cycles) {
+
+	// store registers (mov word [rdi + offset], r16)
+	for(word i = 0; i < dcpu::M_REG_COUNT; ++i)
+		if(live[i]) {
+			emit(0x66);
+			emit(0x44);
+			emit(0x89);
+			emit(0x47 | ((host(i) & 0x7) << 3));
+			emit(i * sizeof(word));
+		}
+	if(live[dcpu::R_OVERFLOW]) {
+		emit(0x66);
+		emit(0x89);
+		emit(0x5F);
+		emit(dcpu::R_OVERFLOW * sizeof(word));
+	}
+
+	// set PC (mov word [rdi + offset], imm16)
+	emit(0x66);
+	emit(0xC7);
+	emit(0x47);
+	emit(dcpu::R_PC * sizeof(word));
+	emit16(pc);
+
+	// add cycles (add qword [rsi], imm32)
+	emit(0x48);
+	emit(0x81);
+	emit(0x06);
+	emit32(cycles);
+
+	// restore callee-saved registers (pop r15 - r12, pop rbx) and return
+	for(halfword i = 0; i < 4; ++i) {
+		emit(0x41);
+		emit(0x5F - i);
+	}
+	emit(0x5B);
+	emit(0xC3);
+}
+
+/*
+ * Emit a single register-only instruction
+ */
+void jit::emit_op(word value) {
+	const decode::op &entry = decode::at(value);
+	halfword a = host(entry.a), b = host(entry.b);
+	bool lit = (entry.form == decode::REG_LIT);
+	word b_lit = entry.b % dcpu::LIT_COUNT;
+
+	// load B into ecx
+	if(lit) {
+		emit(0xB8 | ECX);
+		emit32(b_lit);
+	} else
+		emit_rr(0x89, b, ECX, false);
+
+	switch(entry.code) {
+		case dcpu::SET:
+
+			// mov a, ecx
+			emit_rr(0x89, ECX, a, false);
+			break;
+		case dcpu::ADD:
+
+			// eax = a + b, overflow = (eax > 0xFFFE), a = ax
+			emit_rr(0x89, a, EAX, false);
+			emit_rr(0x01, ECX, EAX, false);
+			emit_ri(0x81, 7, EAX, HIGH - 1, false);
+			emit_rr(0x97, 0, ECX, true);
+			emit_rr(0xB6, EBX, ECX, true);
+			emit_rr(0xB7, a, EAX, true);
+			break;
+		case dcpu::SUB:
+
+			// eax = a - b, overflow = borrow ? 0xFFFF : 0, a = ax
+			emit_rr(0x89, a, EAX, false);
+			emit_rr(0x29, ECX, EAX, false);
+			emit_rr(0x19, EBX, EBX, false);
+			emit_ri(0x81, 4, EBX, HIGH, false);
+			emit_rr(0xB7, a, EAX, true);
+			break;
+		case dcpu::MUL:
+
+			// eax = a * b, overflow = eax >> 16, a = ax
+			emit_rr(0x89, a, EAX, false);
+			emit_rr(0xAF, EAX, ECX, true);
+			emit_rr(0x89, EAX, EBX, false);
+			emit_ri(0xC1, 5, EBX, 16, true);
+			emit_rr(0xB7, a, EAX, true);
+			break;
+		case dcpu::SHL:
+
+			// eax = a << b, overflow = eax >> 16, a = ax
+			emit_rr(0x89, a, EAX, false);
+			emit_ri(0xC1, 4, EAX, b_lit, true);
+			emit_rr(0x89, EAX, EBX, false);
+			emit_ri(0xC1, 5, EBX, 16, true);
+			emit_rr(0xB7, a, EAX, true);
+			break;
+		case dcpu::SHR:
+
+			// overflow = ((a << 16) >> b) & 0xFFFF (arithmetic), a >>= b
+			emit_rr(0x89, a, EBX, false);
+			emit_ri(0xC1, 4, EBX, 16, true);
+			emit_ri(0xC1, 7, EBX, b_lit, true);
+			emit_ri(0x81, 4, EBX, HIGH, false);
+			emit_ri(0xC1, 5, a, b_lit, true);
+			break;
+		case dcpu::AND:
+			emit_rr(0x21, ECX, a, false);
+			break;
+		case dcpu::BOR:
+			emit_rr(0x09, ECX, a, false);
+			break;
+		case dcpu::XOR:
+			emit_rr(0x31, ECX, a, false);
+			break;
+		default:
+			break;
+	}
+}
+
+/*
+ * Returns if an instruction can be translated
+ */
+bool jit::translatable(word value) {
+	const decode::op &entry = decode::at(value);
+
+	// jump to literal
+	if(entry.form == decode::PC_LIT)
+		return true;
+
+	// register-only instructions (shifts by literal only)
+	if(entry.form != decode::REG_REG
+			&& entry.form != decode::REG_LIT)
+		return false;
+	switch(entry.code) {
+		case dcpu::SET:
+		case dcpu::ADD:
+		case dcpu::SUB:
+		case dcpu::MUL:
+		case dcpu::AND:
+		case dcpu::BOR:
+		case dcpu::XOR:
+		case dcpu::IFE:
+		case dcpu::IFN:
+		case dcpu::IFG:
+		case dcpu::IFB:
+			return true;
+		case dcpu::SHL:
+		case dcpu::SHR:
+			return entry.form == decode::REG_LIT;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Translate a block starting at a given address
+ */
+jit::block *jit::translate(word pc, mem128 &mem) {
+	bool live[dcpu::REG_COUNT] = { false };
+	word count = 0, end = pc;
+	size_t cycles = 0;
+
+	// find block extent: straight-line register-only instructions,
+	// conditionals guarding a single non-conditional instruction,
+	// ending after an unconditional jump
+	while(count < BLOCK_LEN && end < HIGH - 1) {
+		const decode::op &entry = decode::at(mem.at(end));
+		if(!translatable(mem.at(end)))
+			break;
+		if(entry.code >= dcpu::IFE) {
+			const decode::op &next = decode::at(mem.at(end + 1));
+			if(!translatable(mem.at(end + 1))
+					|| next.code >= dcpu::IFE
+					|| count + 2 > BLOCK_LEN)
+				break;
+			count += 2;
+			end += 2;
+			continue;
+		}
+		++count;
+		++end;
+		if(entry.form == decode::PC_LIT)
+			break;
+	}
+
+	// record untranslatable instruction, tracking writes to the block pages
+	block *blk = new block;
+	blk->func = NULL;
+	blk->last = count ? end - 1 : pc;
+	mem.mark_code(pc);
+	mem.mark_code(blk->last);
+	blk->version[0] = mem.page_version(pc);
+	blk->version[1] = mem.page_version(blk->last);
+	if(!count || !available())
+		return blk;
+
+	// flush when the buffer is full
+	if(used + BLOCK_BYTES > BUFFER_LEN) {
+		flush();
+		blocks[pc] = NULL;
+	}
+
+	// mark registers used by the block
+	for(word i = pc; i != end; ++i) {
+		const decode::op &entry = decode::at(mem.at(i));
+		if(entry.form == decode::PC_LIT)
+			continue;
+		live[entry.a] = true;
+		if(entry.form == decode::REG_REG)
+			live[entry.b] = true;
+		if(entry.code != dcpu::SET
+				&& entry.code != dcpu::AND
+				&& entry.code != dcpu::BOR
+				&& entry.code != dcpu::XOR
+				&& entry.code < dcpu::IFE)
+			live[dcpu::R_OVERFLOW] = true;
+	}
+	blk->func = (function) &buffer[used];
+
+	// save callee-saved registers (push rbx, push r12 - r15)
+	emit(0x53);
+	for(halfword i = 0; i < 4; ++i) {
+		emit(0x41);
+		emit(0x54 + i);
+	}
+
+	// load registers (movzx r32, word [rdi + offset])
+	for(word i = 0; i < dcpu::M_REG_COUNT; ++i)
+		if(live[i]) {
+			emit(0x44);
+			emit(0x0F);
+			emit(0xB7);
+			emit(0x47 | ((host(i) & 0x7) << 3));
+			emit(i * sizeof(word));
+		}
+	if(live[dcpu::R_OVERFLOW]) {
+		emit(0x0F);
+		emit(0xB7);
+		emit(0x5F);
+		emit(dcpu::R_OVERFLOW * sizeof(word));
+	}
+
+	// emit instructions
+	for(word i = pc; i != end; ++i) {
+		const decode::op &entry = decode::at(mem.at(i));
+
+		// unconditional jump ends the block
+		if(entry.form == decode::PC_LIT) {
+			emit_exit(live, entry.b % dcpu::LIT_COUNT, cycles + entry.cost);
+			break;
+		}
+
+		// straight-line instruction
+		if(entry.code < dcpu::IFE) {
+			emit_op(mem.at(i));
+			cycles += entry.cost;
+			continue;
+		}
+
+		// compare A & B (cmp a, b / test a, b)
+		halfword op = (entry.code == dcpu::IFB) ? 0x85 : 0x39;
+		if(entry.form == decode::REG_LIT) {
+			emit(0xB8 | ECX);
+			emit32(entry.b % dcpu::LIT_COUNT);
+			emit_rr(op, ECX, host(entry.a), false);
+		} else
+			emit_rr(op, host(entry.b), host(entry.a), false);
+
+		// jump to skip when the condition fails (jne, je, jbe, jz)
+		halfword skip;
+		switch(entry.code) {
+			case dcpu::IFE:
+				skip = 0x85;
+				break;
+			case dcpu::IFN:
+				skip = 0x84;
+				break;
+			case dcpu::IFG:
+				skip = 0x86;
+				break;
+			default:
+				skip = 0x84;
+				break;
+		}
+		emit(0x0F);
+		emit(skip);
+		size_t skip_at = used;
+		emit32(0);
+		cycles += entry.cost;
+
+		// taken: run the guarded instruction
+		const decode::op &next = decode::at(mem.at(++i));
+		size_t join_at = 0;
+		if(next.form == decode::PC_LIT)
+			emit_exit(live, next.b % dcpu::LIT_COUNT, cycles + next.cost);
+		else {
+			emit_op(mem.at(i));
+
+			// add cycles (add qword [rsi], imm32), jump over fail path
+			emit(0x48);
+			emit(0x81);
+			emit(0x06);
+			emit32(next.cost);
+			emit(0xE9);
+			join_at = used;
+			emit32(0);
+		}
+
+		// not taken: add fail cycle (add qword [rsi], 1)
+		patch(skip_at);
+		emit(0x48);
+		emit(0x83);
+		emit(0x06);
+		emit(0x01);
+		if(join_at)
+			patch(join_at);
+	}
+
+	// fall through to the next instruction
+	if(decode::at(mem.at(end - 1)).form != decode::PC_LIT
+			|| (count >= 2 && decode::at(mem.at(end - 2)).code >= dcpu::IFE))
+		emit_exit(live, end, cycles);
+	return blk;
+}
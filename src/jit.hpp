@@ -0,0 +1,159 @@
+/*
+ * jit.hpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JIT_HPP_
+#define JIT_HPP_
+
+#include <vector>
+#include "dcpu.hpp"
+#include "mem128.hpp"
+#include "types.hpp"
+
+class jit {
+public:
+
+	/*
+	 * Maximum instructions per block
+	 */
+	static const word BLOCK_LEN = 0x40;
+
+	/*
+	 * Executable buffer size
+	 */
+	static const size_t BUFFER_LEN = 0x400000;
+
+	/*
+	 * Jit constructor
+	 */
+	jit(void);
+
+	/*
+	 * Jit destructor
+	 */
+	virtual ~jit(void);
+
+	/*
+	 * Returns if native translation is available on this host
+	 */
+	bool available(void);
+
+	/*
+	 * Run the block starting at PC, translating it if needed
+	 * (returns false if no block could be translated at PC)
+	 */
+	bool exec(word (&reg)[dcpu::REG_COUNT], size_t &cycle, mem128 &mem);
+
+	/*
+	 * Discard all translated blocks
+	 */
+	void flush(void);
+
+private:
+
+	/*
+	 * Translated block entry point
+	 */
+	typedef void (*function)(word *reg, size_t *cycle);
+
+	/*
+	 * Translated block
+	 */
+	typedef struct {
+		function func;
+		word last;
+		dword version[2];
+	} block;
+
+	/*
+	 * Executable buffer
+	 */
+	halfword *buffer;
+
+	/*
+	 * Executable buffer write offset
+	 */
+	size_t used;
+
+	/*
+	 * Translated blocks by start address
+	 */
+	std::vector<block *> blocks;
+
+	/*
+	 * Jit constructor
+	 */
+	jit(const jit &other);
+
+	/*
+	 * Jit assignment operator
+	 */
+	jit &operator=(const jit &other);
+
+	/*
+	 * Emit a single byte
+	 */
+	void emit(halfword value);
+
+	/*
+	 * Emit a 16-bit immediate
+	 */
+	void emit16(word value);
+
+	/*
+	 * Emit a 32-bit immediate
+	 */
+	void emit32(dword value);
+
+	/*
+	 * Patch a 32-bit relative jump to target the current offset
+	 */
+	void patch(size_t offset);
+
+	/*
+	 * Emit a register-to-register instruction (REX prefix, opcode, ModRM)
+	 */
+	void emit_rr(halfword op, halfword reg, halfword rm, bool ext);
+
+	/*
+	 * Emit an instruction with an immediate (REX prefix, opcode, ModRM)
+	 */
+	void emit_ri(halfword op, halfword ext, halfword rm, dword value, bool imm8);
+
+	/*
+	 * Emit a block exit setting PC and adding cycles
+	 */
+	void emit_exit(const bool (&live)[dcpu::REG_COUNT], word pc, size_t cycles);
+
+	/*
+	 * Emit a single register-only instruction
+	 */
+	void emit_op(word value);
+
+	/*
+	 * Returns if an instruction can be translated
+	 */
+	static bool translatable(word value);
+
+	/*
+	 * Translate a block starting at a given address
+	 */
+	block *translate(word pc, mem128 &mem);
+};
+
+#endif
@@ -0,0 +1,146 @@
+/*
+ * loader.cpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "loader.hpp"
+
+/*
+ * Unmap an image file
+ */
+void loader::close(file &image) {
+	if(image.map)
+		munmap(image.map, image.size);
+	image.map = NULL;
+	image.buffer.clear();
+}
+
+/*
+ * Load an image file into memory at an offset, returning its length
+ * in words through length
+ */
+word loader::load(const std::string &path, mem128 &mem, word offset, word order, dword *length) {
+	file image;
+	word status = open(path, image);
+
+	if(status != LOADED)
+		return status;
+
+	// image must fit above offset
+	dword count = image.size / sizeof(word);
+	if(count > COUNT - offset) {
+		close(image);
+		return TOO_LARGE;
+	}
+
+	// swap words straight from the mapping into memory
+	bswap_copy(&mem.at(offset), image.bytes, count, order);
+	for(dword i = offset & ~(mem128::PAGE_LEN - 1); i < offset + count; i += mem128::PAGE_LEN)
+		mem.touch(i);
+	close(image);
+	if(length)
+		*length = count;
+	return LOADED;
+}
+
+/*
+ * Load an image file into a vector
+ */
+word loader::load(const std::string &path, std::vector<word> &image, word order) {
+	file source;
+	word status = open(path, source);
+
+	if(status != LOADED)
+		return status;
+
+	// image must fit in memory
+	size_t count = source.size / sizeof(word);
+	if(count > COUNT) {
+		close(source);
+		return TOO_LARGE;
+	}
+	image.resize(count);
+	bswap_copy(&image[0], source.bytes, count, order);
+	close(source);
+	return LOADED;
+}
+
+/*
+ * Return a string representation of a load result
+ */
+std::string loader::message(word status) {
+	switch(status) {
+		case LOADED: return "Loaded";
+		case MISSING: return "File does not exist";
+		case BAD_SIZE: return "Invalid binary size";
+		case TOO_LARGE: return "Binary does not fit in memory";
+	}
+	return "Unknown";
+}
+
+/*
+ * Map an image file (reading it if it cannot be mapped)
+ */
+word loader::open(const std::string &path, file &image) {
+	struct stat info;
+	int fd;
+
+	image.bytes = NULL;
+	image.size = 0;
+	image.map = NULL;
+
+	// attempt to open file
+	fd = ::open(path.c_str(), O_RDONLY);
+	if(fd < 0)
+		return MISSING;
+
+	// check file size (whole words only)
+	if(fstat(fd, &info)
+			|| !info.st_size
+			|| (info.st_size % sizeof(word))) {
+		::close(fd);
+		return BAD_SIZE;
+	}
+	image.size = info.st_size;
+
+	// map file, or read it in when it cannot be mapped
+	image.map = mmap(NULL, image.size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(image.map == MAP_FAILED) {
+		image.map = NULL;
+		image.buffer.resize(image.size);
+		size_t offset = 0;
+		while(offset < image.size) {
+			ssize_t count = read(fd, &image.buffer[offset], image.size - offset);
+			if(count <= 0)
+				break;
+			offset += count;
+		}
+		if(offset != image.size) {
+			::close(fd);
+			image.buffer.clear();
+			return BAD_SIZE;
+		}
+		image.bytes = &image.buffer[0];
+	} else
+		image.bytes = static_cast<const halfword *>(image.map);
+	::close(fd);
+	return LOADED;
+}
@@ -0,0 +1,77 @@
+/*
+ * loader.hpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOADER_HPP_
+#define LOADER_HPP_
+
+#include <string>
+#include <vector>
+#include "bswap.hpp"
+#include "mem128.hpp"
+#include "types.hpp"
+
+class loader {
+public:
+
+	/*
+	 * Load results
+	 */
+	enum STATUS { LOADED, MISSING, BAD_SIZE, TOO_LARGE };
+
+	/*
+	 * Load an image file into memory at an offset, returning its length
+	 * in words through length
+	 */
+	static word load(const std::string &path, mem128 &mem, word offset = 0, word order = BIG,
+			dword *length = NULL);
+
+	/*
+	 * Load an image file into a vector
+	 */
+	static word load(const std::string &path, std::vector<word> &image, word order = BIG);
+
+	/*
+	 * Return a string representation of a load result
+	 */
+	static std::string message(word status);
+
+private:
+
+	/*
+	 * Mapped image file
+	 */
+	typedef struct {
+		const halfword *bytes;
+		size_t size;
+		void *map;
+		std::vector<halfword> buffer;
+	} file;
+
+	/*
+	 * Map an image file (reading it if it cannot be mapped)
+	 */
+	static word open(const std::string &path, file &image);
+
+	/*
+	 * Unmap an image file
+	 */
+	static void close(file &image);
+};
+
+#endif
@@ -0,0 +1,452 @@
+/*
+ * lockstep.cpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include "lockstep.hpp"
+
+/*
+ * Lockstep constructor (diverged lanes run on a given engine)
+ */
+lockstep::lockstep(word engine) : split(0) {
+	for(word i = 0; i < LANES; ++i) {
+		lanes[i] = new dcpu(engine);
+		live[i] = false;
+		cycle[i] = 0;
+	}
+}
+
+/*
+ * Lockstep destructor
+ */
+lockstep::~lockstep(void) {
+	for(word i = 0; i < LANES; ++i)
+		delete lanes[i];
+}
+
+/*
+ * Return the number of lanes split off during the last run
+ */
+size_t lockstep::diverged(void) {
+	return split;
+}
+
+/*
+ * Run a command on every live lane through its cpu
+ */
+void lockstep::exec(word pc, bool exe) {
+	for(word i = 0; i < LANES; ++i) {
+		if(!live[i])
+			continue;
+		dcpu &cpu = *lanes[i];
+
+		// run command on the lane's own memory
+		store_lane(i);
+		bool result = cpu.exec(cpu.mem.at(pc), exe);
+		load_lane(i);
+
+		// a malformed command halts the lane
+		if(exe && !result) {
+			cpu.halt();
+			live[i] = false;
+		}
+	}
+	revalidate();
+}
+
+/*
+ * Return a lane (set initial registers before, read results after a run)
+ */
+dcpu &lockstep::lane(word index) {
+	return *lanes[index];
+}
+
+/*
+ * Return the first live lane (or LANES if none are live)
+ */
+word lockstep::leader(void) {
+	word i = 0;
+
+	while(i < LANES && !live[i])
+		++i;
+	return i;
+}
+
+/*
+ * Reset every lane and load an image into its memory
+ */
+void lockstep::load(const std::vector<word> &image) {
+	for(word i = 0; i < LANES; ++i) {
+		lanes[i]->reset();
+		lanes[i]->memory().clear();
+		for(size_t j = 0; j < image.size() && j < COUNT; ++j)
+			lanes[i]->memory().set(j, image[j]);
+	}
+}
+
+/*
+ * Copy a lane's registers and cycles from its cpu into the vectors
+ */
+void lockstep::load_lane(word index) {
+	for(word i = 0; i < dcpu::REG_COUNT; ++i)
+		reg[i][index] = lanes[index]->ctx.reg[i];
+	cycle[index] = lanes[index]->ctx.cycle;
+}
+
+/*
+ * Run all lanes until they halt
+ */
+void lockstep::run(void) {
+	vector *a, b, cond;
+	word first, pc, from = 0;
+
+	// load lanes into vectors
+	split = 0;
+	spin = sample();
+	checks.clear();
+	for(word i = 0; i < mem128::PAGE_COUNT; ++i)
+		verified[i] = false;
+	for(word i = 0; i < LANES; ++i) {
+		lanes[i]->state_change(dcpu::RUN);
+		live[i] = true;
+		load_lane(i);
+	}
+
+	// lanes may start at different PCs
+	split_lanes();
+
+	while((first = leader()) < LANES) {
+		pc = reg[dcpu::R_PC][first];
+		const decode::op &entry = decode::at(lanes[first]->mem.at(pc));
+
+		// halt lanes looping back without progress, as a cpu run does
+		if(pc <= from
+				&& spinning()) {
+			for(word i = 0; i < LANES; ++i)
+				if(live[i]) {
+					live[i] = false;
+					store_lane(i);
+					lanes[i]->halt();
+				}
+			break;
+		}
+		from = pc;
+
+		// run lanes holding different code (or any command that is not
+		// register-only) through their cpus, then split diverged lanes
+		if(entry.form == decode::GENERIC
+				|| !shared(pc)) {
+			exec(pc, true);
+			split_lanes();
+			continue;
+		}
+
+		// jump to literal
+		if(entry.form == decode::PC_LIT) {
+			reg[dcpu::R_PC] = (vector) {} + (word) (entry.b % dcpu::LIT_COUNT);
+			for(word i = 0; i < LANES; ++i)
+				cycle[i] += entry.cost;
+			continue;
+		}
+
+		// fetch register-only operands
+		a = &reg[entry.a];
+		if(entry.form == decode::REG_REG)
+			b = reg[entry.b];
+		else
+			b = (vector) {} + (word) (entry.b % dcpu::LIT_COUNT);
+
+		// conditionals
+		if(entry.code >= dcpu::IFE) {
+			switch(entry.code) {
+				case dcpu::IFE: cond = (vector) (*a == b);
+					break;
+				case dcpu::IFN: cond = (vector) (*a != b);
+					break;
+				case dcpu::IFG: cond = (vector) (*a > b);
+					break;
+				default: cond = (vector) ((*a & b) != 0);
+					break;
+			}
+
+			// count lanes taking the branch
+			word count = 0, taken = 0;
+			for(word i = 0; i < LANES; ++i)
+				if(live[i]) {
+					++count;
+					if(cond[i])
+						++taken;
+				}
+
+			// lanes disagree (or hold different code following a taken
+			// conditional), run the conditional through their cpus
+			if(taken
+					&& (taken != count || !shared(pc + 1))) {
+				exec(pc, true);
+				split_lanes();
+				continue;
+			}
+			reg[dcpu::R_PC] += 1;
+			for(word i = 0; i < LANES; ++i)
+				cycle[i] += entry.cost;
+
+			// all taken (step over a following malformed command)
+			if(taken) {
+				const decode::op &next = decode::at(lanes[first]->mem.at(pc + 1));
+				if(next.code == dcpu::NB
+						&& next.a != dcpu::JSR)
+					reg[dcpu::R_PC] += 1;
+
+			// none taken (skip the following commands by length, lanes
+			// holding different code there skip on their own cpus and
+			// can be left apart)
+			} else {
+				const decode::op *skipped;
+				word next = pc + 1;
+				bool apart = false;
+				dword count = 0;
+
+				for(word i = 0; i < LANES; ++i)
+					++cycle[i];
+				do {
+					apart = !shared(next);
+					skipped = &decode::at(lanes[first]->mem.at(next));
+					next += skipped->length;
+				} while(!apart
+						&& skipped->code >= dcpu::IFE
+						&& ++count < COUNT);
+				if(apart) {
+					skip();
+					split_lanes();
+				} else
+					reg[dcpu::R_PC] = (vector) {} + next;
+			}
+			continue;
+		}
+
+		// register-only arithmetic
+		switch(entry.code) {
+			case dcpu::SET: *a = b;
+				break;
+			case dcpu::ADD: {
+					vector res = *a + b;
+					reg[dcpu::R_OVERFLOW] = ((vector) (res < *a) | (vector) (res == HIGH)) & FLAG;
+					*a = res;
+				} break;
+			case dcpu::SUB:
+				reg[dcpu::R_OVERFLOW] = (vector) (b > *a);
+				*a -= b;
+				break;
+			case dcpu::MUL: {
+					wide res = __builtin_convertvector(*a, wide) * __builtin_convertvector(b, wide);
+					reg[dcpu::R_OVERFLOW] = __builtin_convertvector(res >> 16, vector);
+					*a = __builtin_convertvector(res, vector);
+				} break;
+			case dcpu::AND: *a &= b;
+				break;
+			case dcpu::BOR: *a |= b;
+				break;
+			case dcpu::XOR: *a ^= b;
+				break;
+
+			// no vector division or variable shifts, run per lane
+			default:
+				for(word i = 0; i < LANES; ++i) {
+					word a_val = (*a)[i], b_val = b[i], &over = reg[dcpu::R_OVERFLOW][i];
+					switch(entry.code) {
+						case dcpu::DIV:
+							if(!b_val) {
+								over = LOW;
+								(*a)[i] = LOW;
+							} else {
+								over = ((a_val << 16) / b_val) & HIGH;
+								(*a)[i] = a_val / b_val;
+							}
+							break;
+						case dcpu::MOD: (*a)[i] = b_val ? (a_val % b_val) : LOW;
+							break;
+						case dcpu::SHL:
+							b_val &= dcpu::SHIFT_MASK;
+							over = ((a_val << b_val) >> 16) & HIGH;
+							(*a)[i] = a_val << b_val;
+							break;
+						default:
+							b_val &= dcpu::SHIFT_MASK;
+							over = ((a_val << 16) >> b_val) & HIGH;
+							(*a)[i] = a_val >> b_val;
+							break;
+					}
+				}
+				break;
+		}
+		reg[dcpu::R_PC] += 1;
+		for(word i = 0; i < LANES; ++i)
+			cycle[i] += entry.cost;
+	}
+}
+
+/*
+ * Drop verified pages written by any live lane
+ */
+void lockstep::revalidate(void) {
+	for(size_t i = 0; i < checks.size();) {
+		check &entry = checks[i];
+		bool written = false;
+
+		// compare page versions
+		for(word j = 0; j < LANES; ++j)
+			if(live[j]
+					&& lanes[j]->mem.page_version(entry.page * mem128::PAGE_LEN) != entry.version[j])
+				written = true;
+		if(!written) {
+			++i;
+			continue;
+		}
+		verified[entry.page] = false;
+		entry = checks.back();
+		checks.pop_back();
+	}
+}
+
+/*
+ * Return if all live lanes hold the same word at an address
+ * (verifying its whole page the first time it is fetched)
+ */
+bool lockstep::shared(word address) {
+	word first = leader(), page = address / mem128::PAGE_LEN;
+	word base = page * mem128::PAGE_LEN;
+	check entry;
+
+	if(verified[page])
+		return true;
+
+	// compare the whole page
+	for(word i = first + 1; i < LANES; ++i)
+		if(live[i]
+				&& std::memcmp(&lanes[i]->mem.at(base), &lanes[first]->mem.at(base),
+						mem128::PAGE_LEN * sizeof(word))) {
+
+			// pages differ, compare the single word
+			word value = lanes[first]->mem.at(address);
+			for(word j = first + 1; j < LANES; ++j)
+				if(live[j]
+						&& lanes[j]->mem.at(address) != value)
+					return false;
+			return true;
+		}
+
+	// track writes to the page through its version
+	entry.page = page;
+	for(word i = 0; i < LANES; ++i) {
+		lanes[i]->mem.mark_code(base);
+		entry.version[i] = lanes[i]->mem.page_version(base);
+	}
+	checks.push_back(entry);
+	verified[page] = true;
+	return true;
+}
+
+/*
+ * Skip the command at PC on every live lane through its cpu
+ */
+void lockstep::skip(void) {
+	for(word i = 0; i < LANES; ++i)
+		if(live[i]) {
+			store_lane(i);
+			lanes[i]->skip();
+			load_lane(i);
+		}
+}
+
+/*
+ * Returns if live lanes jumping back made no progress since the last
+ * idle sample (sampled at most once per IDLE_WINDOW cycles), taking
+ * a new sample otherwise
+ */
+bool lockstep::spinning(void) {
+	word first = leader();
+	bool same = spin.taken;
+
+	if(cycle[first] < spin.next)
+		return false;
+
+	// compare live lanes only (the vectors keep changing the registers
+	// of halted and diverged lanes)
+	for(word i = 0; same && i < LANES; ++i) {
+		if(!live[i])
+			continue;
+		same = spin.writes[i] == lanes[i]->mem.writes();
+		for(word j = 0; same && j < dcpu::REG_COUNT; ++j)
+			same = spin.reg[j][i] == reg[j][i];
+	}
+	if(same)
+		return true;
+
+	// take a new sample
+	for(word i = 0; i < LANES; ++i)
+		if(live[i]) {
+			for(word j = 0; j < dcpu::REG_COUNT; ++j)
+				spin.reg[j][i] = reg[j][i];
+			spin.writes[i] = lanes[i]->mem.writes();
+		}
+	spin.next = cycle[first] + dcpu::IDLE_WINDOW;
+	spin.taken = true;
+	return false;
+}
+
+/*
+ * Split off live lanes whose PC differs from the majority
+ */
+void lockstep::split_lanes(void) {
+	word best = LANES, votes = 0;
+	vector &pc = reg[dcpu::R_PC];
+
+	// find the most common PC
+	for(word i = 0; i < LANES; ++i) {
+		if(!live[i])
+			continue;
+		word count = 0;
+		for(word j = i; j < LANES; ++j)
+			if(live[j] && pc[j] == pc[i])
+				++count;
+		if(count > votes) {
+			votes = count;
+			best = i;
+		}
+	}
+
+	// run other lanes to completion on their own cpus
+	for(word i = 0; i < LANES; ++i)
+		if(live[i]
+				&& pc[i] != pc[best]) {
+			live[i] = false;
+			++split;
+			store_lane(i);
+			lanes[i]->halt();
+			lanes[i]->run();
+		}
+}
+
+/*
+ * Copy a lane's registers and cycles from the vectors into its cpu
+ */
+void lockstep::store_lane(word index) {
+	for(word i = 0; i < dcpu::REG_COUNT; ++i)
+		lanes[index]->ctx.reg[i] = reg[i][index];
+	lanes[index]->ctx.cycle = cycle[index];
+}
@@ -0,0 +1,196 @@
+/*
+ * lockstep.hpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOCKSTEP_HPP_
+#define LOCKSTEP_HPP_
+
+#include <vector>
+#include "dcpu.hpp"
+#include "decode.hpp"
+#include "types.hpp"
+
+class lockstep {
+public:
+
+	/*
+	 * Lane count (one 256-bit vector of words)
+	 */
+	static const word LANES = 0x10;
+
+	/*
+	 * Lockstep constructor (diverged lanes run on a given engine)
+	 */
+	lockstep(word engine = dcpu::INTERP);
+
+	/*
+	 * Lockstep destructor
+	 */
+	virtual ~lockstep(void);
+
+	/*
+	 * Return the number of lanes split off during the last run
+	 */
+	size_t diverged(void);
+
+	/*
+	 * Return a lane (set initial registers before, read results after a run)
+	 */
+	dcpu &lane(word index);
+
+	/*
+	 * Reset every lane and load an image into its memory
+	 */
+	void load(const std::vector<word> &image);
+
+	/*
+	 * Run all lanes until they halt (or stop at an idle loop)
+	 */
+	void run(void);
+
+private:
+
+	/*
+	 * Register vector (one word per lane)
+	 */
+	typedef word vector __attribute__((vector_size(LANES * sizeof(word))));
+
+	/*
+	 * Wide register vector (one dword per lane)
+	 */
+	typedef dword wide __attribute__((vector_size(LANES * sizeof(dword))));
+
+	/*
+	 * Registers in structure-of-arrays form (one vector per register)
+	 */
+	vector reg[dcpu::REG_COUNT];
+
+	/*
+	 * Cycle counts
+	 */
+	size_t cycle[LANES];
+
+	/*
+	 * Lanes still running in lockstep
+	 */
+	bool live[LANES];
+
+	/*
+	 * Lane cpus (memory, and state of halted or diverged lanes)
+	 */
+	dcpu *lanes[LANES];
+
+	/*
+	 * Diverged lane count
+	 */
+	size_t split;
+
+	/*
+	 * Pages known to hold the same words in every live lane
+	 */
+	bool verified[mem128::PAGE_COUNT];
+
+	/*
+	 * Idle loop sample (registers & memory write count of each live
+	 * lane when taken, the leader's cycle of the next sample)
+	 */
+	typedef struct {
+		bool taken;
+		vector reg[dcpu::REG_COUNT];
+		size_t writes[LANES];
+		size_t next;
+	} sample;
+
+	/*
+	 * Last idle loop sample
+	 */
+	sample spin;
+
+	/*
+	 * Verified page (with each lane's page version when verified)
+	 */
+	typedef struct {
+		word page;
+		dword version[LANES];
+	} check;
+
+	/*
+	 * Verified pages
+	 */
+	std::vector<check> checks;
+
+	/*
+	 * Lockstep constructor
+	 */
+	lockstep(const lockstep &other);
+
+	/*
+	 * Lockstep assignment operator
+	 */
+	lockstep &operator=(const lockstep &other);
+
+	/*
+	 * Run a command on every live lane through its cpu
+	 */
+	void exec(word pc, bool exe);
+
+	/*
+	 * Return the first live lane (or LANES if none are live)
+	 */
+	word leader(void);
+
+	/*
+	 * Drop verified pages written by any live lane
+	 */
+	void revalidate(void);
+
+	/*
+	 * Return if all live lanes hold the same word at an address
+	 * (verifying its whole page the first time it is fetched)
+	 */
+	bool shared(word address);
+
+	/*
+	 * Skip the command at PC on every live lane through its cpu
+	 */
+	void skip(void);
+
+	/*
+	 * Returns if live lanes jumping back made no progress since the last
+	 * idle sample (sampled at most once per IDLE_WINDOW cycles), taking
+	 * a new sample otherwise
+	 */
+	bool spinning(void);
+
+	/*
+	 * Split off live lanes whose PC differs from the majority
+	 */
+	void split_lanes(void);
+
+	/*
+	 * Copy a lane's registers and cycles from its cpu into the vectors
+	 */
+	void load_lane(word index);
+
+	/*
+	 * Copy a lane's registers and cycles from the vectors into its cpu
+	 */
+	void store_lane(word index);
+};
+
+#endif
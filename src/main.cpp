@@ -18,27 +18,39 @@
  */
 
 #include <csignal>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <vector>
+#include "batch.hpp"
+#include "cfg.hpp"
 #include "dcpu.hpp"
+#include "loader.hpp"
 #include "mem128.hpp"
+#include "pacer.hpp"
+#include "profiler.hpp"
 #include "reg16.hpp"
+#include "sampler.hpp"
+#include "tracer.hpp"
 #include "types.hpp"
 
 /*
  * Supported input flags
  */
-enum FLAG { NONE, PRINT_REG, PRINT_MEM, OUTPUT, INPUT };
+enum FLAG { NONE, PRINT_REG, PRINT_MEM, PRINT_ALL, OUTPUT, INPUT, LIMIT, THREADS, OFFSET, ENDIAN, FREQUENCY, HOTSPOTS, SAMPLE, TRACE, GRAPH, LISTING };
 
 /*
  * Static variables
  */
 static dcpu cpu;
-static int output = NONE, path = NONE;
-static bool print_reg = false, print_mem = false;
-static char *output_path = NULL;
+static int output = NONE;
+static std::vector<int> path;
+static bool print_reg = false, print_mem = false, print_all = false, listing = false;
+static char *output_path = NULL, *sample_path = NULL, *trace_path = NULL, *graph_path = NULL;
+static size_t limit = 0, threads = 0, frequency = 0, hotspots = 0;
+static word offset = 0, order = BIG;
 
 /*
  * Determine if an input is a flag
@@ -48,13 +60,59 @@ int is_flag(const std::string &flag) {
 		return PRINT_REG;
 	else if(flag == "-m")
 		return PRINT_MEM;
+	else if(flag == "-M")
+		return PRINT_ALL;
 	else if(flag == "-d")
 		return OUTPUT;
 	else if(flag == "-p")
 		return INPUT;
+	else if(flag == "-l")
+		return LIMIT;
+	else if(flag == "-t")
+		return THREADS;
+	else if(flag == "-o")
+		return OFFSET;
+	else if(flag == "-e")
+		return ENDIAN;
+	else if(flag == "-f")
+		return FREQUENCY;
+	else if(flag == "-H")
+		return HOTSPOTS;
+	else if(flag == "-s")
+		return SAMPLE;
+	else if(flag == "-T")
+		return TRACE;
+	else if(flag == "-g")
+		return GRAPH;
+	else if(flag == "-G")
+		return LISTING;
 	return NONE;
 }
 
+/*
+ * Report batch execution
+ */
+static int report_batch(batch &jobs, char *argv[]) {
+
+	// print exit reason & cycles (and registers) of each job
+	for(size_t i = 0; i < jobs.size(); ++i) {
+		const batch::result &res = jobs.at(i);
+		std::cout << argv[path.at(i)] << ": " << (res.reason == batch::LIMIT ? "LIMITED"
+				: (res.reason == batch::IDLE ? "IDLE" : "HALTED"))
+				<< ", CYCLE: " << res.cycle << std::endl;
+		if(print_reg) {
+			std::cout << "S_REG { ";
+			for(word j = 0; j < dcpu::S_REG_COUNT; ++j)
+				std::cout << reg16(res.reg[dcpu::M_REG_COUNT + j]).dump() << ", ";
+			std::cout << "}" << std::endl << "M_REG { ";
+			for(word j = 0; j < dcpu::M_REG_COUNT; ++j)
+				std::cout << reg16(res.reg[j]).dump() << ", ";
+			std::cout << "}" << std::endl;
+		}
+	}
+	return 0;
+}
+
 /*
  * Report execution
  */
@@ -63,12 +121,14 @@ static int report(void) {
 	// print cpu info & memory
 	if(print_reg)
 		std::cout << cpu.dump() << std::endl;
-	if(print_mem)
-		std::cout << cpu.memory().dump_all() << std::endl;
+	if(print_mem) {
+		cpu.memory().dump(stdout, LOW, COUNT, !print_all);
+		std::cout << std::endl;
+	}
 
 	// write cpu info & memory to file
 	if(output)
-		if(!cpu.memory().dump_to_file(LOW, HIGH, output_path)) {
+		if(!cpu.memory().dump_to_file(LOW, COUNT, output_path)) {
 			std::cerr << "Exception: Failed to write memory to path" << std::endl;
 			return 1;
 		}
@@ -87,16 +147,16 @@ static void keyboard_interrupt0(int sig) {
  * Main
  */
 int main(int argc, char *argv[]) {
-	halfword low, high;
-	std::ifstream file;
 	std::vector<word> prog;
+	dword length = 0;
+	word status;
 
 	// trap ctrl^c keyboard interrupt
 	std::signal(SIGINT, keyboard_interrupt0);
 
 	// check input
 	if(argc < 2) {
-		std::cerr << "Usage: " << argv[0] << " [-r | -m] [-d PATH] -p PATH..." << std::endl;
+		std::cerr << "Usage: " << argv[0] << " [-r | -m | -M] [-d PATH] [-l CYCLES] [-t THREADS] [-o OFFSET] [-e] [-f HZ] [-H COUNT] [-s PATH] [-T PATH] [-g PATH] [-G] -p PATH..." << std::endl;
 		return 1;
 	}
 	for(int i = 1; i < argc; ++i)
@@ -105,6 +165,8 @@ int main(int argc, char *argv[]) {
 				break;
 			case PRINT_MEM: print_mem = true;
 				break;
+			case PRINT_ALL: print_mem = print_all = true;
+				break;
 			case OUTPUT:
 				if(i == (argc - 1)) {
 					std::cerr << "Exception: Parameter \'-d\' missing operand" << std::endl;
@@ -117,57 +179,165 @@ int main(int argc, char *argv[]) {
 					std::cerr << "Exception: Parameter \'-p\' missing operand" << std::endl;
 					return 1;
 				}
-				path = ++i;
+				path.push_back(++i);
+				break;
+			case LIMIT:
+				if(i == (argc - 1)) {
+					std::cerr << "Exception: Parameter \'-l\' missing operand" << std::endl;
+					return 1;
+				}
+				limit = std::strtoul(argv[++i], NULL, 0);
+				break;
+			case THREADS:
+				if(i == (argc - 1)) {
+					std::cerr << "Exception: Parameter \'-t\' missing operand" << std::endl;
+					return 1;
+				}
+				threads = std::strtoul(argv[++i], NULL, 0);
+				break;
+			case OFFSET:
+				if(i == (argc - 1)) {
+					std::cerr << "Exception: Parameter \'-o\' missing operand" << std::endl;
+					return 1;
+				}
+				offset = std::strtoul(argv[++i], NULL, 0);
+				break;
+			case ENDIAN: order = LITTLE;
+				break;
+			case FREQUENCY:
+				if(i == (argc - 1)) {
+					std::cerr << "Exception: Parameter \'-f\' missing operand" << std::endl;
+					return 1;
+				}
+				frequency = std::strtoul(argv[++i], NULL, 0);
+				break;
+			case HOTSPOTS:
+				if(i == (argc - 1)) {
+					std::cerr << "Exception: Parameter \'-H\' missing operand" << std::endl;
+					return 1;
+				}
+				hotspots = std::strtoul(argv[++i], NULL, 0);
+				break;
+			case SAMPLE:
+				if(i == (argc - 1)) {
+					std::cerr << "Exception: Parameter \'-s\' missing operand" << std::endl;
+					return 1;
+				}
+				sample_path = argv[++i];
+				break;
+			case TRACE:
+				if(i == (argc - 1)) {
+					std::cerr << "Exception: Parameter \'-T\' missing operand" << std::endl;
+					return 1;
+				}
+				trace_path = argv[++i];
+				break;
+			case GRAPH:
+				if(i == (argc - 1)) {
+					std::cerr << "Exception: Parameter \'-g\' missing operand" << std::endl;
+					return 1;
+				}
+				graph_path = argv[++i];
+				break;
+			case LISTING: listing = true;
 				break;
 			default: std::cerr << "Exception: Invalid parameter \'" << argv[i] << "\'" << std::endl;
 				return 1;
 		}
 
 	// check if input path was given
-	if(!path) {
+	if(path.empty()) {
 		std::cerr << "Exception: No input path specified" << std::endl;
 		return 1;
 	}
 
+	// run several input paths as a batch
+	if(path.size() > 1) {
+		if(print_mem
+				|| output
+				|| graph_path
+				|| listing) {
+			std::cerr << "Exception: Parameters \'-m\', \'-M\', \'-d\', \'-g\' and \'-G\' take a single input path" << std::endl;
+			return 1;
+		}
+		batch jobs(threads);
+		for(size_t i = 0; i < path.size(); ++i) {
+			status = loader::load(argv[path.at(i)], prog, order);
+			if(status == loader::LOADED
+					&& prog.size() > COUNT - offset)
+				status = loader::TOO_LARGE;
+			if(status != loader::LOADED) {
+				std::cerr << "Exception: \'" << argv[path.at(i)] << "\' (" << loader::message(status) << ")" << std::endl;
+				return 1;
+			}
+			jobs.add(prog, offset, limit);
+		}
+		jobs.run();
+		return report_batch(jobs, argv);
+	}
+
 	// check if output path was given
 	if(output)
 		output_path = argv[output];
 
-	// attempt to open file
-	file.open(argv[path], std::ios::in | std::ios::binary);
-	if(!file.is_open()) {
-		std::cerr << "Exception: \'" << argv[path] << "\' (file does not exist)" << std::endl;
+	// load file into memory
+	status = loader::load(argv[path.front()], cpu.memory(), offset, order, &length);
+	if(status != loader::LOADED) {
+		std::cerr << "Exception: \'" << argv[path.front()] << "\' (" << loader::message(status) << ")" << std::endl;
 		return 1;
 	}
 
-	// check file size
-	file.seekg(0, std::ios::end);
-	size_t size = file.tellg();
-	file.seekg(0, std::ios::beg);
-	if(!size
-			|| (size % 2)) {
-		std::cerr << "Exception: Invalid binary size" << std::endl;
-		return 1;
-	}
-
-	// read in file
-	while(file.good()) {
-		file.read((char *) &high, sizeof(halfword));
-		file.read((char *) &low, sizeof(halfword));
-
-		// big endian!
-		prog.push_back((word) ((high << 8) | low));
+	// print or write the control flow graph of the image instead of running it
+	if(graph_path
+			|| listing) {
+		cfg graph;
+		graph.build(cpu.memory(), offset, offset, length);
+		if(listing)
+			std::cout << graph.dump(cpu.memory());
+		if(graph_path) {
+			std::ofstream file(graph_path);
+			if(!(file << graph.dot(cpu.memory()))) {
+				std::cerr << "Exception: Failed to write graph to path" << std::endl;
+				return 1;
+			}
+		}
+		return 0;
 	}
-	if(!prog.empty())
-		prog.erase(prog.end() - 1);
-	file.close();
 
-	// add instructions to memory
-	for(size_t i = 0; i < prog.size(); ++i)
-		cpu.memory().set(i, prog.at(i));
-
-	// run cpu
-	cpu.run();
+	// run cpu (traced, sampled, profiled, or paced to a clock rate if one was given)
+	if(trace_path) {
+		tracer trace(cpu, trace_path);
+		if(!trace.is_open()) {
+			std::cerr << "Exception: Failed to open trace path" << std::endl;
+			return 1;
+		}
+		cpu.run(limit ? limit : SIZE_MAX, trace);
+		if(!limit)
+			cpu.halt();
+	} else if(sample_path) {
+		sampler probe(sample_path);
+		if(!probe.is_open()) {
+			std::cerr << "Exception: Failed to open sample path" << std::endl;
+			return 1;
+		}
+		probe.run(cpu, limit ? limit : SIZE_MAX);
+		if(!limit)
+			cpu.halt();
+	} else if(hotspots) {
+		profiler prof;
+		cpu.run(limit ? limit : SIZE_MAX, prof);
+		if(!limit)
+			cpu.halt();
+		std::cout << prof.report(cpu.memory(), hotspots);
+	} else if(frequency) {
+		pacer clock(cpu, frequency);
+		clock.run(limit ? limit : SIZE_MAX);
+		if(print_reg)
+			std::cout << clock.dump() << std::endl;
+	} else if(limit)
+		cpu.run(limit);
+	else
+		cpu.run();
 
 	// run report operations
 	return report();
@@ -17,30 +17,66 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <fstream>
-#include <iomanip>
-#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <vector>
 #include "mem128.hpp"
+#include "writer.hpp"
+
+/*
+ * Upper case hex digit pairs of every byte value
+ */
+static const struct hex_table {
+	char pair[0x100][2];
+
+	hex_table(void) {
+		static const char DIGIT[] = "0123456789ABCDEF";
+
+		for(word i = 0; i < 0x100; ++i) {
+			pair[i][0] = DIGIT[i >> 4];
+			pair[i][1] = DIGIT[i & 0xF];
+		}
+	}
+} HEX;
+
+/*
+ * Format a word as four hex digits, returning the end of the digits
+ */
+static inline char *format_word(char *out, word value) {
+	memcpy(out, HEX.pair[value >> 8], 2);
+	memcpy(out + 2, HEX.pair[value & 0xFF], 2);
+	return out + 4;
+}
 
 /*
  * Mem constructor
  */
 mem128::mem128(void) {
-	clear();
+	init();
+	memset(words, 0, sizeof(words));
+	cleared = checkpoint();
 }
 
 /*
  * Mem constructor
  */
 mem128::mem128(const mem128 &other) {
-	memcpy(words, other.words, COUNT);
+	init();
+	memcpy(words, other.words, sizeof(words));
+
+	// keep track of pages known to be zero
+	memcpy(stamp, other.stamp, sizeof(stamp));
+	epoch = other.epoch;
+	cleared = other.cleared;
 }
 
 /*
  * Mem constructor
  */
 mem128::mem128(const word (&words)[COUNT]) {
-	memcpy(this->words, words, COUNT);
+	init();
+	memcpy(this->words, words, sizeof(this->words));
+	touch(LOW, COUNT);
 }
 
 /*
@@ -51,7 +87,7 @@ mem128::~mem128(void) {
 }
 
 /*
- * Memory assignment operator
+ * Memory assignment operator (copies only pages that differ)
  */
 mem128 &mem128::operator=(const mem128 &other) {
 
@@ -59,13 +95,21 @@ mem128 &mem128::operator=(const mem128 &other) {
 	if(this == &other)
 		return *this;
 
-	// set attributes
-	memcpy(words, other.words, COUNT);
+	// copy pages that differ (skipping pages zero in both)
+	for(dword i = 0; i < COUNT; i += PAGE_LEN) {
+		if(stamp[i / PAGE_LEN] <= cleared
+				&& other.stamp[i / PAGE_LEN] <= other.cleared)
+			continue;
+		if(memcmp(&words[i], &other.words[i], PAGE_LEN * sizeof(word))) {
+			memcpy(&words[i], &other.words[i], PAGE_LEN * sizeof(word));
+			touch(i);
+		}
+	}
 	return *this;
 }
 
 /*
- * Memory equals operator
+ * Memory equals operator (skips pages zero in both)
  */
 bool mem128::operator==(const mem128 &other) {
 
@@ -73,10 +117,14 @@ bool mem128::operator==(const mem128 &other) {
 	if(this == &other)
 		return true;
 
-	// check attributes
-	for(word i = 0; i < COUNT; ++i)
-		if(words[i] != other.words[i])
+	// compare pages (skipping pages zero in both)
+	for(dword i = 0; i < COUNT; i += PAGE_LEN) {
+		if(stamp[i / PAGE_LEN] <= cleared
+				&& other.stamp[i / PAGE_LEN] <= other.cleared)
+			continue;
+		if(memcmp(&words[i], &other.words[i], PAGE_LEN * sizeof(word)))
 			return false;
+	}
 	return true;
 }
 
@@ -95,57 +143,69 @@ word &mem128::at(word offset) {
 }
 
 /*
- * Clear mem
+ * Clear mem (zeroes only pages written since the last clear)
  */
 void mem128::clear(void) {
-	fill_all(LOW);
+
+	// zero pages written since the last clear
+	for(dword i = 0; i < COUNT; i += PAGE_LEN)
+		if(written(i, cleared)) {
+			memset(&words[i], 0, PAGE_LEN * sizeof(word));
+			touch(i);
+		}
+	cleared = checkpoint();
 }
 
 /*
  * Return a string representation of a given offset and range
+ * (collapsing rows repeating the row above into '*')
  */
-std::string mem128::dump(word offset, word range) {
-	std::stringstream ss;
+std::string mem128::dump(word offset, dword range, bool collapse) {
+	bool repeat = false;
+	dword finish = offset + std::min<dword>(range, COUNT - offset);
+	std::vector<char> buffer((((finish - offset) / ROW_LEN) + 1) * (ROW_CHARS + 1));
 
-	// iterate through elements
-	for(word i = 0; i < range; ++i) {
-		if(!(i % 16)) {
-			if(i)
-				ss << std::endl;
-			ss << "0x" << std::hex << std::uppercase << std::setfill('0') << std::setw(4) << (offset + i) << " | ";
-		}
+	// format all rows at once
+	char *end = format(&buffer[0], offset, finish, offset, finish, collapse, repeat);
+	return std::string(&buffer[0], end);
+}
 
-		// convert each element into hex
-		ss << std::hex << std::uppercase << std::setfill('0') << std::setw(4) << (unsigned)(word) words[offset + i] << " ";
+/*
+ * Write a string representation of a given offset and range to a stream
+ * (collapsing rows repeating the row above into '*')
+ */
+bool mem128::dump(FILE *file, word offset, dword range, bool collapse) {
+	bool repeat = false;
+	dword finish = offset + std::min<dword>(range, COUNT - offset);
+	std::vector<char> buffer(CHUNK_ROWS * (ROW_CHARS + 1));
+
+	// format & write a chunk of rows at a time
+	for(dword i = offset; i < finish; i += CHUNK_ROWS * ROW_LEN) {
+		char *end = format(&buffer[0], offset, finish, i, std::min<dword>(i + (CHUNK_ROWS * ROW_LEN), finish),
+				collapse, repeat);
+		if(fwrite(&buffer[0], sizeof(char), end - &buffer[0], file) != (size_t) (end - &buffer[0]))
+			return false;
 	}
-	return ss.str();
+	return !ferror(file);
 }
 
 /*
  * Return a string representation of all memory
+ * (collapsing rows repeating the row above into '*')
  */
-std::string mem128::dump_all(void) {
-	return dump(LOW, HIGH);
+std::string mem128::dump_all(bool collapse) {
+	return dump(LOW, COUNT, collapse);
 }
 
 /*
  * Dump memory to file at a given path
  */
-bool mem128::dump_to_file(word offset, word range, const std::string &path) {
-
-	// attempt to open file at path
-	std::ofstream file(path.c_str(), std::ios::out | std::ios::ate | std::ios::binary);
-	if(!file.is_open())
-		return false;
+bool mem128::dump_to_file(word offset, dword range, const std::string &path) {
+	writer file;
 
-	// write memory to file
-	for(word i = 0; i < range; ++i) {
-		const char *bytes = reinterpret_cast<const char *>(&words[offset + i]);
-		file.write(&bytes[1], sizeof(halfword));
-		file.write(&bytes[0], sizeof(halfword));
-	}
-	file.close();
-	return true;
+	// write range (clipped to the end of memory) in one call
+	file.add(&words[offset], std::min<dword>(range, COUNT - offset));
+	return file.write(path);
 }
 
 /*
@@ -157,13 +217,76 @@ void mem128::fill(word offset, word range, word value) {
 	// assign values
 	for(word i = offset; i < finish; ++i)
 		words[i] = value;
+	touch(offset, range);
 }
 
 /*
  * Fill mem with a given value
  */
 void mem128::fill_all(word value) {
-	fill(LOW, HIGH, value);
+
+	// assign values (including the last word)
+	for(dword i = 0; i < COUNT; ++i)
+		words[i] = value;
+	touch(LOW, COUNT);
+	if(value == LOW)
+		cleared = checkpoint();
+}
+
+/*
+ * Format rows from begin to end of a dump from offset to finish,
+ * returning the end of the formatted text (repeat holds whether the
+ * previous row was collapsed)
+ */
+char *mem128::format(char *out, dword offset, dword finish, dword begin, dword end, bool collapse,
+		bool &repeat) {
+
+	for(dword i = begin; i < end; i += ROW_LEN) {
+		dword count = std::min<dword>(ROW_LEN, finish - i);
+
+		// collapse full rows repeating the row above (keeping the last)
+		if(collapse
+				&& i > offset
+				&& i + ROW_LEN < finish
+				&& !memcmp(&words[i], &words[i - ROW_LEN], ROW_LEN * sizeof(word))) {
+			if(!repeat) {
+				memcpy(out, "\n*", 2);
+				out += 2;
+				repeat = true;
+			}
+			continue;
+		}
+		repeat = false;
+
+		// address
+		if(i != offset)
+			*out++ = '\n';
+		memcpy(out, "0x", 2);
+		out = format_word(out + 2, i);
+		memcpy(out, " | ", 3);
+		out += 3;
+
+		// words
+		for(dword j = 0; j < count; ++j) {
+			out = format_word(out, words[i + j]);
+			*out++ = ' ';
+		}
+	}
+	return out;
+}
+
+/*
+ * Initialize page tracking
+ */
+void mem128::init(void) {
+	memset(code, 0, sizeof(code));
+	memset(version, 0, sizeof(version));
+	memset(stamp, 0, sizeof(stamp));
+	epoch = 1;
+	cleared = 0;
+	changes = 0;
+	source = 0;
+	source_epoch = 0;
 }
 
 /*
@@ -171,14 +294,29 @@ void mem128::fill_all(word value) {
  */
 void mem128::set(word offset, word value) {
 	words[offset] = value;
+	touch(offset);
 }
 
 /*
- * Set value at offset
+ * Set a range of values at offset (range must fit above offset)
  */
-void mem128::set(word offset, word range, word *value) {
+void mem128::set(word offset, dword range, const word *value) {
 
 	// assign values
-	for(word i = 0; i < range; ++i)
-		words[i + offset] = value[i];
+	memcpy(&words[offset], value, range * sizeof(word));
+	touch(offset, range);
+}
+
+/*
+ * Invalidate cached code in pages from offset to range offset
+ */
+void mem128::touch(word offset, dword range) {
+
+	// an empty range writes nothing
+	if(!range)
+		return;
+
+	// touch first word of every page in range
+	for(dword i = offset & ~(PAGE_LEN - 1); i < (dword) offset + range; i += PAGE_LEN)
+		touch(i);
 }
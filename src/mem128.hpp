@@ -20,11 +20,32 @@
 #ifndef MEM128_HPP_
 #define MEM128_HPP_
 
+#include <cstdio>
 #include <cstring>
 #include <string>
 #include "types.hpp"
 
 class mem128 {
+public:
+
+	/*
+	 * Dump row length (words), formatted row length (characters) and
+	 * rows formatted per stream write
+	 */
+	static const word ROW_LEN = 0x10;
+	static const word ROW_CHARS = 0x09 + (ROW_LEN * 0x05);
+	static const word CHUNK_ROWS = 0x100;
+
+	/*
+	 * Page length (words)
+	 */
+	static const word PAGE_LEN = 0x100;
+
+	/*
+	 * Page count
+	 */
+	static const word PAGE_COUNT = 0x100;
+
 private:
 
 	/*
@@ -32,6 +53,65 @@ private:
 	 */
 	word words[COUNT];
 
+	/*
+	 * Pages holding cached code (one bit per page)
+	 */
+	dword code[PAGE_COUNT / 32];
+
+	/*
+	 * Page versions (bumped when a code page is written)
+	 */
+	dword version[PAGE_COUNT];
+
+	/*
+	 * Page write epochs (the epoch each page was last written in)
+	 */
+	dword stamp[PAGE_COUNT];
+
+	/*
+	 * Current write epoch
+	 */
+	dword epoch;
+
+	/*
+	 * Epoch ended by the last clear (pages unwritten since are zero)
+	 */
+	dword cleared;
+
+	/*
+	 * Writes made (counted per touch)
+	 */
+	size_t changes;
+
+	/*
+	 * Id of the snapshot memory matched when last synced (zero if
+	 * none) and the epoch ended by that sync
+	 */
+	size_t source;
+	dword source_epoch;
+
+	/*
+	 * Snapshots (read & sync pages through stamps)
+	 */
+	friend class snapshot;
+
+	/*
+	 * Format rows from begin to end of a dump from offset to finish,
+	 * returning the end of the formatted text (repeat holds whether the
+	 * previous row was collapsed)
+	 */
+	char *format(char *out, dword offset, dword finish, dword begin, dword end, bool collapse, bool &repeat);
+
+	/*
+	 * Initialize page tracking
+	 */
+	void init(void);
+
+	/*
+	 * Invalidate cached code in pages from offset to range offset
+	 */
+	void touch(word offset, dword range);
+
 public:
 
 	/*
@@ -55,12 +135,12 @@ public:
 	virtual ~mem128(void);
 
 	/*
-	 * Mem assignment operator
+	 * Mem assignment operator (copies only pages that differ)
 	 */
 	mem128 &operator=(const mem128 &other);
 
 	/*
-	 * Mem equals operator
+	 * Mem equals operator (skips pages zero in both)
 	 */
 	bool operator==(const mem128 &other);
 
@@ -71,28 +151,44 @@ public:
 
 	/*
 	 * Return value at offset
+	 * (writes through the reference must be followed by touch)
 	 */
 	word &at(word offset);
 
 	/*
-	 * Clear mem
+	 * Start a new write epoch, returning the one that ended
+	 */
+	dword checkpoint(void) {
+		return epoch++;
+	}
+
+	/*
+	 * Clear mem (zeroes only pages written since the last clear)
 	 */
 	void clear(void);
 
 	/*
 	 * Return a string representation of a given offset and range
+	 * (collapsing rows repeating the row above into '*')
 	 */
-	std::string dump(word offset, word range);
+	std::string dump(word offset, dword range, bool collapse = false);
+
+	/*
+	 * Write a string representation of a given offset and range to a stream
+	 * (collapsing rows repeating the row above into '*')
+	 */
+	bool dump(FILE *file, word offset, dword range, bool collapse = false);
 
 	/*
 	 * Return a string representation of all memory
+	 * (collapsing rows repeating the row above into '*')
 	 */
-	std::string dump_all(void);
+	std::string dump_all(bool collapse = false);
 
 	/*
 	 * Dump memory to file at a given path
 	 */
-	bool dump_to_file(word offset, word range, const std::string &path);
+	bool dump_to_file(word offset, dword range, const std::string &path);
 
 	/*
 	 * Fill mem from offset to offset and range offset with a given value
@@ -104,15 +200,61 @@ public:
 	 */
 	void fill_all(word value);
 
+	/*
+	 * Mark the page at offset as holding cached code
+	 */
+	void mark_code(word offset) {
+		code[offset / (PAGE_LEN * 32)] |= 1 << ((offset / PAGE_LEN) % 32);
+	}
+
+	/*
+	 * Return the version of the page at offset
+	 */
+	dword page_version(word offset) {
+		return version[offset / PAGE_LEN];
+	}
+
 	/*
 	 * Set value at offset
 	 */
 	void set(word offset, word value);
 
 	/*
-	 * Set value at offset
+	 * Set a range of values at offset (range must fit above offset)
+	 */
+	void set(word offset, dword range, const word *value);
+
+	/*
+	 * Return the number of writes made (a range counts once per page)
 	 */
-	void set(word offset, word range, word *value);
+	size_t writes(void) {
+		return changes;
+	}
+
+	/*
+	 * Return if the page at offset was written after a given epoch ended
+	 */
+	bool written(word offset, dword since) {
+		return stamp[offset / PAGE_LEN] > since;
+	}
+
+	/*
+	 * Invalidate cached code in the page at offset after a write
+	 */
+	void touch(word offset) {
+		dword &bits = code[offset / (PAGE_LEN * 32)];
+		dword bit = 1 << ((offset / PAGE_LEN) % 32);
+
+		// stamp page with the current epoch
+		stamp[offset / PAGE_LEN] = epoch;
+		++changes;
+
+		// bump version of code pages
+		if(bits & bit) {
+			bits &= ~bit;
+			++version[offset / PAGE_LEN];
+		}
+	}
 };
 
 #endif
@@ -0,0 +1,170 @@
+/*
+ * pacer.cpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <thread>
+#include "pacer.hpp"
+
+/*
+ * Pacer constructor
+ */
+pacer::pacer(dcpu &cpu, size_t frequency, size_t period) : cpu(cpu), rate(frequency ? frequency : 1),
+		period(period ? period : 1), woken(false) {
+	info = stats();
+}
+
+/*
+ * Pacer destructor
+ */
+pacer::~pacer(void) {
+	return;
+}
+
+/*
+ * Return pacing statistics as a string
+ */
+std::string pacer::dump(void) {
+	std::stringstream ss;
+
+	ss << "PACE { " << rate << " Hz, PERIODS: " << info.periods << ", LATE: " << info.late
+			<< ", DROPPED: " << info.dropped << ", JITTER: "
+			<< (info.periods ? (info.jitter_total / info.periods) * 1e6 : 0.0) << " us avg, "
+			<< info.jitter_max * 1e6 << " us max, SLEEP: " << info.sleep << " s, IDLE: "
+			<< info.idle << " s }";
+	return ss.str();
+}
+
+/*
+ * Return the guest clock rate (Hz)
+ */
+size_t pacer::frequency(void) {
+	return rate;
+}
+
+/*
+ * Park the cpu until woken or a number of seconds has passed,
+ * returning if it was woken
+ */
+bool pacer::park(double seconds) {
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	std::unique_lock<std::mutex> guard(lock);
+	bool result;
+
+	// wait for a wake (only for a wake past the longest timed park)
+	if(seconds > MAX_PARK)
+		signal.wait(guard, [this]() { return woken; });
+	else
+		signal.wait_for(guard, std::chrono::duration<double>(seconds), [this]() { return woken; });
+	result = woken;
+	woken = false;
+	info.idle += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	return result;
+}
+
+/*
+ * Run the cpu paced to its clock rate for a budget of cycles,
+ * returning why it stopped
+ *
+ * Deadlines are taken from the cycles actually run since the start
+ * of the run, not summed per period, so sleep overshoot and budget
+ * overrun are corrected on the next period instead of accumulating.
+ * A run more than MAX_LAG periods behind moves its start forward
+ * rather than running flat out to catch up. A cpu reaching an idle
+ * loop is parked instead of spinning, and paced from its wake-up.
+ */
+word pacer::run(size_t budget) {
+	size_t slice = std::max<size_t>(1, ((double) rate * period) / 1e6);
+	size_t first = cpu.cycles(), base = first;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	word reason = dcpu::BUDGET;
+
+	while(reason == dcpu::BUDGET
+			&& cpu.cycles() - first < budget) {
+
+		// run one period of guest cycles
+		reason = cpu.run(std::min(slice, budget - (cpu.cycles() - first)));
+		++info.periods;
+
+		// park an idle cpu for the wall time its budget had left (a run
+		// may end past the budget, leaving none)
+		if(reason == dcpu::IDLE) {
+			if(cpu.cycles() - first >= budget
+					|| !park((double) (budget - (cpu.cycles() - first)) / rate))
+				break;
+			reason = dcpu::BUDGET;
+			start = std::chrono::steady_clock::now();
+			base = cpu.cycles();
+			continue;
+		}
+
+		// sleep until the wall clock reaches the guest clock
+		std::chrono::steady_clock::time_point deadline = start
+				+ std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+				std::chrono::duration<double>((double) (cpu.cycles() - base) / rate));
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if(now < deadline) {
+			std::this_thread::sleep_until(deadline);
+			std::chrono::steady_clock::time_point woke = std::chrono::steady_clock::now();
+			info.sleep += std::chrono::duration<double>(woke - now).count();
+			now = woke;
+		}
+
+		// record wake-up error past the deadline
+		double error = std::chrono::duration<double>(now - deadline).count();
+		info.jitter_total += error;
+		info.jitter_max = std::max(info.jitter_max, error);
+
+		// resync when too far behind to catch up
+		if(error * 1e6 > (double) period) {
+			++info.late;
+			if(error * 1e6 > (double) (MAX_LAG * period)) {
+				info.dropped += (size_t) ((error * 1e6) / period);
+				start = now;
+				base = cpu.cycles();
+			}
+		}
+	}
+	return reason;
+}
+
+/*
+ * Set the guest clock rate (Hz)
+ */
+void pacer::set_frequency(size_t frequency) {
+	rate = frequency ? frequency : 1;
+}
+
+/*
+ * Return pacing statistics
+ */
+const pacer::stats &pacer::statistics(void) {
+	return info;
+}
+
+/*
+ * Wake a parked cpu (from another thread, after changing its state;
+ * a wake before the cpu parks is kept for its next park)
+ */
+void pacer::wake(void) {
+	std::lock_guard<std::mutex> guard(lock);
+	woken = true;
+	signal.notify_one();
+}
@@ -0,0 +1,158 @@
+/*
+ * pacer.hpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PACER_HPP_
+#define PACER_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include "dcpu.hpp"
+#include "types.hpp"
+
+class pacer {
+public:
+
+	/*
+	 * Default guest clock rate (Hz)
+	 */
+	static const size_t FREQUENCY = 100000;
+
+	/*
+	 * Default wall time run between sleeps (microseconds)
+	 */
+	static const size_t PERIOD = 1000;
+
+	/*
+	 * Periods a run may fall behind before it stops catching up
+	 */
+	static const size_t MAX_LAG = 0x04;
+
+	/*
+	 * Longest timed park (seconds, longer parks wait only for a wake)
+	 */
+	static const size_t MAX_PARK = 0x100000;
+
+	/*
+	 * Pacing statistics (periods run, periods that woke late, periods
+	 * dropped by resyncing, total & worst wake-up error past a deadline,
+	 * time slept and time parked idle, in seconds)
+	 */
+	typedef struct {
+		size_t periods;
+		size_t late;
+		size_t dropped;
+		double jitter_total;
+		double jitter_max;
+		double sleep;
+		double idle;
+	} stats;
+
+	/*
+	 * Pacer constructor
+	 */
+	pacer(dcpu &cpu, size_t frequency = FREQUENCY, size_t period = PERIOD);
+
+	/*
+	 * Pacer destructor
+	 */
+	virtual ~pacer(void);
+
+	/*
+	 * Return pacing statistics as a string
+	 */
+	std::string dump(void);
+
+	/*
+	 * Return the guest clock rate (Hz)
+	 */
+	size_t frequency(void);
+
+	/*
+	 * Run the cpu paced to its clock rate for a budget of cycles,
+	 * returning why it stopped (a cpu reaching an idle loop is parked
+	 * until woken, or stops as IDLE once its remaining budget's worth
+	 * of wall time has passed)
+	 */
+	word run(size_t budget = SIZE_MAX);
+
+	/*
+	 * Set the guest clock rate (Hz)
+	 */
+	void set_frequency(size_t frequency);
+
+	/*
+	 * Return pacing statistics
+	 */
+	const stats &statistics(void);
+
+	/*
+	 * Wake a parked cpu (from another thread, after changing its state;
+	 * a wake before the cpu parks is kept for its next park)
+	 */
+	void wake(void);
+
+private:
+
+	/*
+	 * Paced cpu
+	 */
+	dcpu &cpu;
+
+	/*
+	 * Guest clock rate (Hz)
+	 */
+	size_t rate;
+
+	/*
+	 * Wall time run between sleeps (microseconds)
+	 */
+	size_t period;
+
+	/*
+	 * Pacing statistics
+	 */
+	stats info;
+
+	/*
+	 * Wake-up lock, signal & pending flag
+	 */
+	std::mutex lock;
+	std::condition_variable signal;
+	bool woken;
+
+	/*
+	 * Pacer constructor
+	 */
+	pacer(const pacer &other);
+
+	/*
+	 * Pacer assignment operator
+	 */
+	pacer &operator=(const pacer &other);
+
+	/*
+	 * Park the cpu until woken or a number of seconds has passed,
+	 * returning if it was woken
+	 */
+	bool park(double seconds);
+};
+
+#endif
@@ -0,0 +1,165 @@
+/*
+ * pool.cpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pool.hpp"
+
+/*
+ * Index of the current worker thread
+ */
+static thread_local size_t current = 0;
+
+/*
+ * Pool constructor (zero threads sizes the pool to the machine)
+ */
+pool::pool(size_t threads) : queued(0), pending(0), next(0), stop(false) {
+
+	// size pool to the machine
+	if(!threads)
+		threads = std::thread::hardware_concurrency();
+	if(!threads)
+		threads = 1;
+
+	// start workers
+	for(size_t i = 0; i < threads; ++i)
+		queues.push_back(new queue);
+	for(size_t i = 0; i < threads; ++i)
+		workers.push_back(std::thread(&pool::worker, this, i));
+}
+
+/*
+ * Pool destructor (waits for queued tasks)
+ */
+pool::~pool(void) {
+	wait();
+
+	// stop workers
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stop = true;
+	}
+	ready.notify_all();
+	for(size_t i = 0; i < workers.size(); ++i)
+		workers[i].join();
+	for(size_t i = 0; i < queues.size(); ++i)
+		delete queues[i];
+}
+
+/*
+ * Return the index of the calling worker thread
+ */
+size_t pool::index(void) {
+	return current;
+}
+
+/*
+ * Return the number of worker threads
+ */
+size_t pool::size(void) {
+	return workers.size();
+}
+
+/*
+ * Queue a task
+ */
+void pool::submit(const task &work) {
+	queue *target = queues[next++ % queues.size()];
+
+	// count the task before it becomes visible to workers
+	++pending;
+	++queued;
+	{
+		std::lock_guard<std::mutex> guard(target->lock);
+		target->tasks.push_back(work);
+	}
+
+	// wake a sleeping worker
+	{
+		std::lock_guard<std::mutex> guard(lock);
+	}
+	ready.notify_one();
+}
+
+/*
+ * Take a task from a worker's own queue, or steal one from another
+ */
+bool pool::take(size_t index, task &work) {
+
+	// newest task from own queue
+	{
+		queue *own = queues[index];
+		std::lock_guard<std::mutex> guard(own->lock);
+		if(!own->tasks.empty()) {
+			work = own->tasks.back();
+			own->tasks.pop_back();
+			--queued;
+			return true;
+		}
+	}
+
+	// oldest task from another queue
+	for(size_t i = 1; i < queues.size(); ++i) {
+		queue *victim = queues[(index + i) % queues.size()];
+		std::lock_guard<std::mutex> guard(victim->lock);
+		if(!victim->tasks.empty()) {
+			work = victim->tasks.front();
+			victim->tasks.pop_front();
+			--queued;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Wait until all queued tasks have finished
+ */
+void pool::wait(void) {
+	std::unique_lock<std::mutex> guard(lock);
+	while(pending)
+		done.wait(guard);
+}
+
+/*
+ * Worker thread loop
+ */
+void pool::worker(size_t index) {
+	task work;
+
+	current = index;
+	for(;;) {
+
+		// run queued tasks
+		if(take(index, work)) {
+			work();
+			work = task();
+			if(!--pending) {
+				std::lock_guard<std::mutex> guard(lock);
+				done.notify_all();
+			}
+			continue;
+		}
+
+		// sleep until tasks are queued or the pool stops
+		std::unique_lock<std::mutex> guard(lock);
+		while(!stop && !queued)
+			ready.wait(guard);
+		if(stop && !queued)
+			return;
+	}
+}
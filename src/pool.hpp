@@ -0,0 +1,146 @@
+/*
+ * pool.hpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef POOL_HPP_
+#define POOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "types.hpp"
+
+class pool {
+public:
+
+	/*
+	 * Pool task
+	 */
+	typedef std::function<void(void)> task;
+
+	/*
+	 * Pool constructor (zero threads sizes the pool to the machine)
+	 */
+	pool(size_t threads = 0);
+
+	/*
+	 * Pool destructor (waits for queued tasks)
+	 */
+	virtual ~pool(void);
+
+	/*
+	 * Return the index of the calling worker thread
+	 */
+	static size_t index(void);
+
+	/*
+	 * Return the number of worker threads
+	 */
+	size_t size(void);
+
+	/*
+	 * Queue a task
+	 */
+	void submit(const task &work);
+
+	/*
+	 * Wait until all queued tasks have finished
+	 */
+	void wait(void);
+
+private:
+
+	/*
+	 * Per-worker task queue
+	 */
+	typedef struct {
+		std::mutex lock;
+		std::deque<task> tasks;
+	} queue;
+
+	/*
+	 * Worker threads
+	 */
+	std::vector<std::thread> workers;
+
+	/*
+	 * Worker queues (one per worker)
+	 */
+	std::vector<queue *> queues;
+
+	/*
+	 * Sleep lock
+	 */
+	std::mutex lock;
+
+	/*
+	 * Signaled when tasks are queued or the pool stops
+	 */
+	std::condition_variable ready;
+
+	/*
+	 * Signaled when all tasks have finished
+	 */
+	std::condition_variable done;
+
+	/*
+	 * Tasks queued but not yet taken
+	 */
+	std::atomic<size_t> queued;
+
+	/*
+	 * Tasks queued but not yet finished
+	 */
+	std::atomic<size_t> pending;
+
+	/*
+	 * Next queue to receive a submitted task
+	 */
+	std::atomic<size_t> next;
+
+	/*
+	 * Stop flag
+	 */
+	bool stop;
+
+	/*
+	 * Pool constructor
+	 */
+	pool(const pool &other);
+
+	/*
+	 * Pool assignment operator
+	 */
+	pool &operator=(const pool &other);
+
+	/*
+	 * Take a task from a worker's own queue, or steal one from another
+	 */
+	bool take(size_t index, task &work);
+
+	/*
+	 * Worker thread loop
+	 */
+	void worker(size_t index);
+};
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ * profiler.cpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include "disasm.hpp"
+#include "profiler.hpp"
+
+/*
+ * Profiler constructor
+ */
+profiler::profiler(void) : count(COUNT, 0), spent(COUNT, 0) {
+	return;
+}
+
+/*
+ * Profiler destructor
+ */
+profiler::~profiler(void) {
+	return;
+}
+
+/*
+ * Clear all counters
+ */
+void profiler::clear(void) {
+	std::fill(count.begin(), count.end(), 0);
+	std::fill(spent.begin(), spent.end(), 0);
+}
+
+/*
+ * Return cycles spent on commands at an address
+ */
+size_t profiler::cycles(word address) {
+	return spent[address];
+}
+
+/*
+ * Return the number of commands run at an address
+ */
+size_t profiler::hits(word address) {
+	return count[address];
+}
+
+/*
+ * Return a hotspot report of the addresses with the most cycles,
+ * disassembled from memory
+ */
+std::string profiler::report(mem128 &mem, size_t top) {
+	std::vector<word> hot;
+	size_t sum = total();
+	std::string out;
+	char buf[0x80];
+
+	// collect addresses run, most cycles first (lowest address on ties)
+	for(dword i = 0; i < COUNT; ++i)
+		if(count[i])
+			hot.push_back(i);
+	top = std::min(top, hot.size());
+	std::partial_sort(hot.begin(), hot.begin() + top, hot.end(), [this](word lhs, word rhs) {
+			return spent[lhs] != spent[rhs] ? spent[lhs] > spent[rhs] : lhs < rhs;
+		});
+
+	// print address, cycles, share of total, hits & disassembly
+	std::snprintf(buf, sizeof(buf), "%-6s  %12s  %6s  %12s  %s\n", "ADDR", "CYCLES", "%", "HITS", "COMMAND");
+	out += buf;
+	for(size_t i = 0; i < top; ++i) {
+		std::snprintf(buf, sizeof(buf), "0x%04X  %12zu  %6.2f  %12zu  ", hot[i], spent[hot[i]],
+				sum ? (100.0 * spent[hot[i]]) / sum : 0.0, count[hot[i]]);
+		out += buf + disasm::at(mem, hot[i]) + "\n";
+	}
+	return out;
+}
+
+/*
+ * Return total cycles recorded
+ */
+size_t profiler::total(void) {
+	size_t sum = 0;
+
+	for(dword i = 0; i < COUNT; ++i)
+		sum += spent[i];
+	return sum;
+}
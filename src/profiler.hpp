@@ -0,0 +1,134 @@
+/*
+ * profiler.hpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROFILER_HPP_
+#define PROFILER_HPP_
+
+#include <string>
+#include <vector>
+#include "mem128.hpp"
+#include "types.hpp"
+
+class profiler {
+public:
+
+	/*
+	 * Default hotspot report length
+	 */
+	static const size_t TOP = 0x10;
+
+	/*
+	 * Run the command a passing IF* guards as its own step, so it is
+	 * recorded at its own address
+	 */
+	static const bool SPLIT = true;
+
+	/*
+	 * Disabled profiler policy (records compile out)
+	 */
+	class none {
+	public:
+
+		/*
+		 * Run passing IF* commands inline (nothing is recorded)
+		 */
+		static const bool SPLIT = false;
+
+		/*
+		 * Note a command about to run at an address
+		 */
+		void fetch(word /* address */, word /* op */) {
+			return;
+		}
+
+		/*
+		 * Record a command run at an address
+		 */
+		void record(word /* address */, word /* op */, size_t /* cost */) {
+			return;
+		}
+	};
+
+	/*
+	 * Profiler constructor
+	 */
+	profiler(void);
+
+	/*
+	 * Profiler destructor
+	 */
+	virtual ~profiler(void);
+
+	/*
+	 * Clear all counters
+	 */
+	void clear(void);
+
+	/*
+	 * Note a command about to run at an address (nothing is kept)
+	 */
+	void fetch(word /* address */, word /* op */) {
+		return;
+	}
+
+	/*
+	 * Return cycles spent on commands at an address
+	 */
+	size_t cycles(word address);
+
+	/*
+	 * Return the number of commands run at an address
+	 */
+	size_t hits(word address);
+
+	/*
+	 * Record a command run at an address, charging it a cost in cycles
+	 * (a failed IF* is charged for the skip, a passing IF* only for
+	 * itself: the command it runs is recorded at its own address)
+	 */
+	void record(word address, word /* op */, size_t cost) {
+		++count[address];
+		spent[address] += cost;
+	}
+
+	/*
+	 * Return a hotspot report of the addresses with the most cycles,
+	 * disassembled from memory
+	 */
+	std::string report(mem128 &mem, size_t top = TOP);
+
+	/*
+	 * Return total cycles recorded
+	 */
+	size_t total(void);
+
+private:
+
+	/*
+	 * Commands run per address
+	 */
+	std::vector<size_t> count;
+
+	/*
+	 * Cycles spent per address
+	 */
+	std::vector<size_t> spent;
+};
+
+#endif
@@ -18,29 +18,29 @@
  */
 
 #include <algorithm>
-#include <fstream>
 #include <iomanip>
 #include <sstream>
 #include "reg16.hpp"
+#include "writer.hpp"
 
 /*
  * Register constructor
  */
-reg16::reg16(void) : value(LOW) {
+reg16::reg16(void) : local(LOW), value(&local) {
 	return;
 }
 
 /*
  * Register constructor
  */
-reg16::reg16(const reg16 &other) : value(other.value) {
+reg16::reg16(const reg16 &other) : local(*other.value), value(&local) {
 	return;
 }
 
 /*
  * Register constructor
  */
-reg16::reg16(word reg) : value(reg) {
+reg16::reg16(word reg) : local(reg), value(&local) {
 	return;
 }
 
@@ -61,7 +61,7 @@ reg16 &reg16::operator=(const reg16 &other) {
 		return *this;
 
 	// set attributes
-	value = other.value;
+	*value = *other.value;
 	return *this;
 }
 
@@ -75,7 +75,7 @@ bool reg16::operator==(const reg16 &other) {
 		return true;
 
 	// set attributes
-	return value == other.value;
+	return *value == *other.value;
 }
 
 /*
@@ -89,119 +89,126 @@ bool reg16::operator!=(const reg16 &other) {
  * Register addition operator
  */
 reg16 reg16::operator+(const reg16 &other) {
-	return reg16(value + other.value);
+	return reg16(*value + *other.value);
 }
 
 /*
  * Register subtraction operator
  */
 reg16 reg16::operator-(const reg16 &other) {
-	return reg16(value - other.value);
+	return reg16(*value - *other.value);
 }
 
 /*
  * Register multiplication operator
  */
 reg16 reg16::operator*(const reg16 &other) {
-	return reg16(value * other.value);
+	return reg16(*value * *other.value);
 }
 
 /*
  * Register division operator
  */
 reg16 reg16::operator/(const reg16 &other) {
-	return reg16(value / other.value);
+	return reg16(*value / *other.value);
 }
 
 /*
  * Register left shift operator
  */
 reg16 reg16::operator>>(const reg16 &other) {
-	return reg16(value >> other.value);
+	return reg16(*value >> *other.value);
 }
 
 /*
  * Register right shift operator
  */
 reg16 reg16::operator<<(const reg16 &other) {
-	return reg16(value << other.value);
+	return reg16(*value << *other.value);
 }
 
 /*
  * Register modulus operator
  */
 reg16 reg16::operator%(const reg16 &other) {
-	return reg16(value % other.value);
+	return reg16(*value % *other.value);
 }
 
 /*
  * Register binary AND operator
  */
 reg16 reg16::operator&(const reg16 &other) {
-	return reg16(value & other.value);
+	return reg16(*value & *other.value);
 }
 
 /*
  * Register binary OR operator
  */
 reg16 reg16::operator|(const reg16 &other) {
-	return reg16(value | other.value);
+	return reg16(*value | *other.value);
 }
 
 /*
  * Register binary XOR operator
  */
 reg16 reg16::operator^(const reg16 &other) {
-	return reg16(value ^ other.value);
+	return reg16(*value ^ *other.value);
 }
 
 /*
  * Register logical AND operator
  */
 bool reg16::operator&&(const reg16 &other) {
-	return value && other.value;
+	return *value && *other.value;
 }
 
 /*
  * Register logical OR operator
  */
 bool reg16::operator||(const reg16 &other) {
-	return value || other.value;
+	return *value || *other.value;
 }
 
 /*
  * Register unary negaition operator
  */
 reg16 reg16::operator!(void) {
-	return reg16(HIGH - value);
+	return reg16(HIGH - *value);
 }
 
 /*
  * Register unary increment operator (prefix)
  */
 reg16 reg16::operator++(void) {
-	return reg16(++value);
+	return reg16(++*value);
 }
 
 /*
  * Register unary increment operator (postfix)
  */
 reg16 reg16::operator++(int i) {
-	return reg16(value++);
+	return reg16((*value)++);
 }
 
 /*
  * Register unary decrement operator
  */
 reg16 reg16::operator--(void) {
-	return reg16(--value);
+	return reg16(--*value);
 }
 
 /*
  * Register unary decrement operator (postfix)
  */
 reg16 reg16::operator--(int i) {
-	return reg16(value--);
+	return reg16((*value)--);
+}
+
+/*
+ * Bind a register to external storage (the register becomes a view)
+ */
+void reg16::bind(word &value) {
+	this->value = &value;
 }
 
 /*
@@ -212,14 +219,14 @@ bool reg16::bit(word offset) {
 	// check offset
 	if(offset >= 0x8)
 		return false;
-	return value & (1 << offset);
+	return *value & (1 << offset);
 }
 
 /*
  * Clear register
  */
 void reg16::clear(void) {
-	value = LOW;
+	*value = LOW;
 }
 
 /*
@@ -229,7 +236,7 @@ std::string reg16::dump(void) {
 	std::stringstream ss;
 
 	// convert element into hex
-	ss << "0x" << std::hex << std::uppercase << std::setfill('0') << std::setw(4) << (unsigned)(word) value;
+	ss << "0x" << std::hex << std::uppercase << std::setfill('0') << std::setw(4) << (unsigned)(word) *value;
 	return ss.str();
 }
 
@@ -237,39 +244,32 @@ std::string reg16::dump(void) {
  * Dump memory to file at a given path
  */
 bool reg16::dump_to_file(const std::string &path) {
+	writer file;
 
-	// attempt to open file at path
-	std::ofstream file(path.c_str(), std::ios::out | std::ios::ate | std::ios::binary);
-	if(!file.is_open())
-		return false;
-
-	// write memory to file
-	const char *bytes = reinterpret_cast<const char *>(&value);
-	file.write(&bytes[1], sizeof(halfword));
-	file.write(&bytes[0], sizeof(halfword));
-	file.close();
-	return true;
+	// write register to file
+	file.add(value, 1);
+	return file.write(path);
 }
 
 /*
  * Return a register value
  */
 word &reg16::get(void) {
-	return value;
+	return *value;
 }
 
 /*
  * Return if a register value is zero
  */
 bool reg16::is_zero(void) {
-	return value == LOW;
+	return *value == LOW;
 }
 
 /*
  * Set a register value
  */
 void reg16::set(word value) {
-	this->value = value;
+	*this->value = value;
 }
 
 /*
@@ -280,5 +280,5 @@ void reg16::set_bit(word offset) {
 	// check offset
 	if(offset >= 0x8)
 		return;
-	value ^= (1 << offset);
+	*value ^= (1 << offset);
 }
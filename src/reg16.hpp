@@ -27,9 +27,14 @@ class reg16 {
 private:
 
 	/*
-	 * Value
+	 * Local value (used unless bound to external storage)
 	 */
-	word value;
+	word local;
+
+	/*
+	 * Value location
+	 */
+	word *value;
 
 public:
 
@@ -153,6 +158,11 @@ public:
 	 */
 	bool operator!=(const reg16 &other);
 
+	/*
+	 * Bind a register to external storage (the register becomes a view)
+	 */
+	void bind(word &value);
+
 	/*
 	 * Return a bit at a given offset
 	 */
@@ -0,0 +1,188 @@
+/*
+ * replay.cpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include "replay.hpp"
+
+/*
+ * Replay constructor (checkpoints a cpu at its current state)
+ */
+replay::replay(dcpu &cpu, size_t interval) : cpu(cpu), interval(interval ? interval : 1) {
+	saved.push_back(new snapshot(cpu));
+}
+
+/*
+ * Replay destructor
+ */
+replay::~replay(void) {
+	for(size_t i = 0; i < saved.size(); ++i)
+		delete saved[i];
+}
+
+/*
+ * Return the index of the last checkpoint taken before a cycle count
+ */
+size_t replay::before(size_t cycle) {
+	size_t index = saved.size() - 1;
+
+	while(index
+			&& saved[index]->cycles() >= cycle)
+		--index;
+	return index;
+}
+
+/*
+ * Checkpoint the cpu, sharing pages unwritten since the last checkpoint
+ */
+void replay::checkpoint(void) {
+	saved.push_back(new snapshot(cpu, *saved.back()));
+}
+
+/*
+ * Return the number of checkpoints held
+ */
+size_t replay::checkpoints(void) {
+	return saved.size();
+}
+
+/*
+ * Restore a checkpoint and run commands until the cycle count reaches
+ * a cycle (returns false if the cpu halts first)
+ */
+bool replay::forward(size_t index, size_t cycle) {
+	saved[index]->restore(cpu);
+	while(cpu.cycles() < cycle)
+		if(cpu.step() != dcpu::BUDGET)
+			return false;
+	return true;
+}
+
+/*
+ * Return the bytes of memory pages held by checkpoints (pages
+ * shared between checkpoints are counted once)
+ */
+size_t replay::memory(void) {
+	size_t count = saved.front()->pages();
+
+	// checkpoints only share pages with the one before
+	for(size_t i = 1; i < saved.size(); ++i)
+		count += saved[i]->pages() - saved[i]->shared(*saved[i - 1]);
+	return count * mem128::PAGE_LEN * sizeof(word);
+}
+
+/*
+ * Move back to the last command run at a breakpoint, or to the
+ * first checkpoint if there is none (returns false if none was found)
+ */
+bool replay::reverse_continue(void) {
+	size_t end = cpu.cycles();
+
+	// search each span between checkpoints, latest first
+	for(size_t index = before(end) + 1; index--;) {
+		size_t found = SIZE_MAX;
+
+		saved[index]->restore(cpu);
+		while(cpu.cycles() < end) {
+			if(cpu.is_breakpoint(cpu.s_register(dcpu::PC).get()))
+				found = cpu.cycles();
+			if(cpu.step() != dcpu::BUDGET)
+				break;
+		}
+		if(found != SIZE_MAX)
+			return forward(index, found);
+		end = saved[index]->cycles();
+	}
+	saved.front()->restore(cpu);
+	return false;
+}
+
+/*
+ * Move back one command (returns false at the first checkpoint)
+ */
+bool replay::reverse_step(void) {
+	size_t end = cpu.cycles(), last;
+	size_t index = before(end);
+
+	if(end <= saved.front()->cycles())
+		return false;
+
+	// find the start of the command before the current cycle, then
+	// run back up to it
+	saved[index]->restore(cpu);
+	last = cpu.cycles();
+	while(cpu.cycles() < end) {
+		last = cpu.cycles();
+		if(cpu.step() != dcpu::BUDGET)
+			break;
+	}
+	return forward(index, last);
+}
+
+/*
+ * Run the cpu for a budget of cycles, checkpointing it every interval
+ * and returning why it stopped (checkpoints past the current cycle
+ * are discarded first)
+ */
+word replay::run(size_t budget) {
+	size_t first = cpu.cycles();
+	word reason = dcpu::BUDGET;
+
+	// the run replaces any history past the current cycle
+	while(saved.size() > 1
+			&& saved.back()->cycles() > first) {
+		delete saved.back();
+		saved.pop_back();
+	}
+
+	while(reason == dcpu::BUDGET
+			&& cpu.cycles() - first < budget) {
+		size_t due = saved.back()->cycles() + interval;
+		if(due <= cpu.cycles())
+			due = cpu.cycles() + 1;
+		reason = cpu.run(std::min(due - cpu.cycles(), budget - (cpu.cycles() - first)));
+		if(cpu.cycles() >= due)
+			checkpoint();
+	}
+	return reason;
+}
+
+/*
+ * Move to the first command boundary at or past a cycle count by
+ * restoring the nearest checkpoint and running forward (returns
+ * false if the cycle precedes the first checkpoint or the cpu halts
+ * first)
+ */
+bool replay::seek(size_t cycle) {
+	size_t index;
+
+	if(cycle < saved.front()->cycles())
+		return false;
+
+	// run on from the current cycle when no checkpoint is closer
+	index = before(cycle + 1);
+	if(cpu.cycles() <= cycle
+			&& cpu.cycles() >= saved[index]->cycles()
+			&& cpu.is_running()) {
+		while(cpu.cycles() < cycle)
+			if(cpu.step() != dcpu::BUDGET)
+				return false;
+		return true;
+	}
+	return forward(index, cycle);
+}
@@ -0,0 +1,128 @@
+/*
+ * replay.hpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPLAY_HPP_
+#define REPLAY_HPP_
+
+#include <cstdint>
+#include <vector>
+#include "dcpu.hpp"
+#include "snapshot.hpp"
+#include "types.hpp"
+
+class replay {
+public:
+
+	/*
+	 * Default cycles between checkpoints
+	 */
+	static const size_t INTERVAL = 0x10000;
+
+	/*
+	 * Replay constructor (checkpoints a cpu at its current state)
+	 */
+	replay(dcpu &cpu, size_t interval = INTERVAL);
+
+	/*
+	 * Replay destructor
+	 */
+	virtual ~replay(void);
+
+	/*
+	 * Return the number of checkpoints held
+	 */
+	size_t checkpoints(void);
+
+	/*
+	 * Return the bytes of memory pages held by checkpoints (pages
+	 * shared between checkpoints are counted once)
+	 */
+	size_t memory(void);
+
+	/*
+	 * Move back to the last command run at a breakpoint, or to the
+	 * first checkpoint if there is none (returns false if none was found)
+	 */
+	bool reverse_continue(void);
+
+	/*
+	 * Move back one command (returns false at the first checkpoint)
+	 */
+	bool reverse_step(void);
+
+	/*
+	 * Run the cpu for a budget of cycles, checkpointing it every interval
+	 * and returning why it stopped (checkpoints past the current cycle
+	 * are discarded first)
+	 */
+	word run(size_t budget = SIZE_MAX);
+
+	/*
+	 * Move to the first command boundary at or past a cycle count by
+	 * restoring the nearest checkpoint and running forward (returns
+	 * false if the cycle precedes the first checkpoint or the cpu halts
+	 * first)
+	 */
+	bool seek(size_t cycle);
+
+private:
+
+	/*
+	 * Recorded cpu
+	 */
+	dcpu &cpu;
+
+	/*
+	 * Cycles between checkpoints
+	 */
+	size_t interval;
+
+	/*
+	 * Checkpoints (oldest first)
+	 */
+	std::vector<snapshot *> saved;
+
+	/*
+	 * Replay constructor
+	 */
+	replay(const replay &other);
+
+	/*
+	 * Replay assignment operator
+	 */
+	replay &operator=(const replay &other);
+
+	/*
+	 * Return the index of the last checkpoint taken before a cycle count
+	 */
+	size_t before(size_t cycle);
+
+	/*
+	 * Checkpoint the cpu, sharing pages unwritten since the last checkpoint
+	 */
+	void checkpoint(void);
+
+	/*
+	 * Restore a checkpoint and run commands until the cycle count reaches
+	 * a cycle (returns false if the cpu halts first)
+	 */
+	bool forward(size_t index, size_t cycle);
+};
+
+#endif
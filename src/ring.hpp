@@ -0,0 +1,109 @@
+/*
+ * ring.hpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RING_HPP_
+#define RING_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include "types.hpp"
+
+/*
+ * Lock-free ring buffer for a single producer and a single consumer
+ * (SIZE must be a power of two)
+ */
+template<class T, size_t SIZE> class ring {
+public:
+
+	/*
+	 * Ring constructor
+	 */
+	ring(void) : head(0), tail(0) {
+		static_assert(SIZE && !(SIZE & (SIZE - 1)), "ring size must be a power of two");
+	}
+
+	/*
+	 * Ring destructor
+	 */
+	virtual ~ring(void) {
+		return;
+	}
+
+	/*
+	 * Remove the oldest item (consumer only), returning false if empty
+	 */
+	bool pop(T &value) {
+		size_t pos = tail.load(std::memory_order_relaxed);
+
+		if(pos == head.load(std::memory_order_acquire))
+			return false;
+		value = items[pos & (SIZE - 1)];
+		tail.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*
+	 * Add an item (producer only), returning false if full
+	 */
+	bool push(const T &value) {
+		size_t pos = head.load(std::memory_order_relaxed);
+
+		if(pos - tail.load(std::memory_order_acquire) == SIZE)
+			return false;
+		items[pos & (SIZE - 1)] = value;
+		head.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*
+	 * Return the number of items held
+	 */
+	size_t size(void) {
+		return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+	}
+
+private:
+
+	/*
+	 * Items
+	 */
+	T items[SIZE];
+
+	/*
+	 * Next slot written by the producer (own cache line)
+	 */
+	alignas(64) std::atomic<size_t> head;
+
+	/*
+	 * Next slot read by the consumer (own cache line)
+	 */
+	alignas(64) std::atomic<size_t> tail;
+
+	/*
+	 * Ring constructor
+	 */
+	ring(const ring &other);
+
+	/*
+	 * Ring assignment operator
+	 */
+	ring &operator=(const ring &other);
+};
+
+#endif
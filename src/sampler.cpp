@@ -0,0 +1,225 @@
+/*
+ * sampler.cpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include "bswap.hpp"
+#include "decode.hpp"
+#include "sampler.hpp"
+
+/*
+ * Words buffered by the writer thread before each write
+ */
+static const size_t BUFFER_LEN = 0x1000;
+
+/*
+ * Returns if a call to JSR ends just before an address (the return
+ * address a JSR pushes), setting the call site
+ */
+static bool is_return(mem128 &mem, word address, word &site) {
+	for(word len = 1; len <= 2; ++len) {
+		const decode::op &entry = decode::at(mem.at(address - len));
+		if(!entry.code
+				&& entry.a == dcpu::JSR
+				&& entry.length == len) {
+			site = address - len;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Write buffered words to a file in big endian order
+ */
+static void flush(std::FILE *file, std::vector<word> &buffer) {
+	std::vector<halfword> bytes(buffer.size() * sizeof(word));
+
+	if(buffer.empty())
+		return;
+	bswap_copy(&bytes[0], &buffer[0], buffer.size(), BIG);
+	std::fwrite(&bytes[0], 1, bytes.size(), file);
+	buffer.clear();
+}
+
+/*
+ * Sampler constructor (starts a thread writing samples to a file
+ * at a given path)
+ */
+sampler::sampler(const std::string &path, size_t interval) : interval(interval ? interval : 1), count(0),
+		lost(0), stop(false) {
+	file = std::fopen(path.c_str(), "wb");
+	if(!file)
+		return;
+
+	// header (magic & interval)
+	word fields[] = { MAGIC, (word) (this->interval >> 16), (word) this->interval };
+	std::vector<word> header(fields, fields + (sizeof(fields) / sizeof(word)));
+	flush(file, header);
+	worker = std::thread(&sampler::drain, this);
+}
+
+/*
+ * Sampler destructor (writes remaining samples)
+ */
+sampler::~sampler(void) {
+	if(!file)
+		return;
+	stop = true;
+	worker.join();
+	std::fclose(file);
+}
+
+/*
+ * Writer thread loop (drains the ring to the sample file)
+ */
+void sampler::drain(void) {
+	std::vector<word> buffer;
+	sample entry;
+
+	for(;;) {
+		bool done = stop;
+
+		// encode samples as PC, SP, depth & call sites
+		while(pending.pop(entry)) {
+			buffer.push_back(entry.pc);
+			buffer.push_back(entry.sp);
+			buffer.push_back(entry.depth);
+			buffer.insert(buffer.end(), entry.frame, entry.frame + entry.depth);
+			if(buffer.size() >= BUFFER_LEN)
+				flush(file, buffer);
+		}
+		if(done)
+			break;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	flush(file, buffer);
+}
+
+/*
+ * Return the number of samples dropped while the ring was full
+ */
+size_t sampler::dropped(void) {
+	return lost;
+}
+
+/*
+ * Read a sample file, writing folded stacks (root first, one line
+ * per distinct stack with its sample count) to a stream
+ */
+bool sampler::fold(const std::string &path, std::ostream &out) {
+	std::ifstream in(path.c_str(), std::ios::binary);
+	std::map<std::string, size_t> stacks;
+	char name[0x08];
+
+	// read & swap sample file
+	if(!in)
+		return false;
+	std::vector<halfword> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	std::vector<word> words(bytes.size() / sizeof(word));
+	if(!words.empty())
+		bswap_copy(&words[0], &bytes[0], words.size(), BIG);
+	if(words.size() < 3
+			|| words[0] != MAGIC)
+		return false;
+
+	// count each stack (call sites outermost first, then PC)
+	for(size_t i = 3; i + 3 <= words.size();) {
+		word pc = words[i], depth = words[i + 2];
+		std::string stack;
+		if(depth > MAX_DEPTH
+				|| i + 3 + depth > words.size())
+			return false;
+		for(word j = depth; j > 0; --j) {
+			std::snprintf(name, sizeof(name), "0x%04X", words[i + 2 + j]);
+			stack += std::string(name) + ";";
+		}
+		std::snprintf(name, sizeof(name), "0x%04X", pc);
+		++stacks[stack + name];
+		i += 3 + depth;
+	}
+	for(std::map<std::string, size_t>::iterator it = stacks.begin(); it != stacks.end(); ++it)
+		out << it->first << " " << it->second << std::endl;
+	return true;
+}
+
+/*
+ * Returns if the sample file is open
+ */
+bool sampler::is_open(void) {
+	return file != NULL;
+}
+
+/*
+ * Record a sample of a cpu (returns false if the ring was full)
+ */
+bool sampler::record(dcpu &cpu) {
+	sample entry;
+	mem128 &mem = cpu.memory();
+
+	entry.pc = cpu.s_register(dcpu::PC).get();
+	entry.sp = cpu.s_register(dcpu::SP).get();
+	entry.depth = 0;
+
+	// scan the stack (SP up to the top of memory) for return addresses
+	if(entry.sp)
+		for(dword address = entry.sp; address < std::min<dword>(COUNT, entry.sp + SCAN_LEN)
+				&& entry.depth < MAX_DEPTH; ++address) {
+			word site;
+			if(is_return(mem, mem.at(address), site))
+				entry.frame[entry.depth++] = site;
+		}
+	if(!pending.push(entry)) {
+		++lost;
+		return false;
+	}
+	++count;
+	return true;
+}
+
+/*
+ * Run a cpu for a budget of cycles, sampling it every interval,
+ * returning why it stopped
+ *
+ * Runs are split at the interval through the cpu's cycle budget, so
+ * every engine can be sampled; threaded and jit runs stop between
+ * basic blocks, which biases their samples toward block entries.
+ */
+word sampler::run(dcpu &cpu, size_t budget) {
+	size_t first = cpu.cycles();
+	word reason = dcpu::BUDGET;
+
+	while(reason == dcpu::BUDGET
+			&& cpu.cycles() - first < budget) {
+		reason = cpu.run(std::min(interval, budget - (cpu.cycles() - first)));
+		if(reason == dcpu::BUDGET)
+			record(cpu);
+	}
+	return reason;
+}
+
+/*
+ * Return the number of samples recorded
+ */
+size_t sampler::samples(void) {
+	return count;
+}
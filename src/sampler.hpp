@@ -0,0 +1,168 @@
+/*
+ * sampler.hpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SAMPLER_HPP_
+#define SAMPLER_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "dcpu.hpp"
+#include "ring.hpp"
+#include "types.hpp"
+
+class sampler {
+public:
+
+	/*
+	 * Default cycles between samples
+	 */
+	static const size_t INTERVAL = 0x400;
+
+	/*
+	 * Maximum call stack depth recorded per sample
+	 */
+	static const word MAX_DEPTH = 0x10;
+
+	/*
+	 * Maximum stack words scanned for return addresses
+	 */
+	static const word SCAN_LEN = 0x40;
+
+	/*
+	 * Samples buffered between the cpu and the writer thread
+	 */
+	static const size_t RING_LEN = 0x1000;
+
+	/*
+	 * Sample file header
+	 */
+	static const word MAGIC = 0x5350;
+
+	/*
+	 * Sample (PC, SP and call sites, innermost first)
+	 */
+	typedef struct {
+		word pc;
+		word sp;
+		word depth;
+		word frame[MAX_DEPTH];
+	} sample;
+
+	/*
+	 * Sampler constructor (starts a thread writing samples to a file
+	 * at a given path)
+	 */
+	sampler(const std::string &path, size_t interval = INTERVAL);
+
+	/*
+	 * Sampler destructor (writes remaining samples)
+	 */
+	virtual ~sampler(void);
+
+	/*
+	 * Return the number of samples dropped while the ring was full
+	 */
+	size_t dropped(void);
+
+	/*
+	 * Read a sample file, writing folded stacks (root first, one line
+	 * per distinct stack with its sample count) to a stream
+	 */
+	static bool fold(const std::string &path, std::ostream &out);
+
+	/*
+	 * Returns if the sample file is open
+	 */
+	bool is_open(void);
+
+	/*
+	 * Run a cpu for a budget of cycles, sampling it every interval,
+	 * returning why it stopped
+	 */
+	word run(dcpu &cpu, size_t budget = SIZE_MAX);
+
+	/*
+	 * Record a sample of a cpu (returns false if the ring was full)
+	 */
+	bool record(dcpu &cpu);
+
+	/*
+	 * Return the number of samples recorded
+	 */
+	size_t samples(void);
+
+private:
+
+	/*
+	 * Cycles between samples
+	 */
+	size_t interval;
+
+	/*
+	 * Sample file
+	 */
+	std::FILE *file;
+
+	/*
+	 * Samples waiting to be written
+	 */
+	ring<sample, RING_LEN> pending;
+
+	/*
+	 * Samples recorded
+	 */
+	size_t count;
+
+	/*
+	 * Samples dropped
+	 */
+	size_t lost;
+
+	/*
+	 * Stop flag
+	 */
+	std::atomic<bool> stop;
+
+	/*
+	 * Writer thread
+	 */
+	std::thread worker;
+
+	/*
+	 * Sampler constructor
+	 */
+	sampler(const sampler &other);
+
+	/*
+	 * Sampler assignment operator
+	 */
+	sampler &operator=(const sampler &other);
+
+	/*
+	 * Writer thread loop (drains the ring to the sample file)
+	 */
+	void drain(void);
+};
+
+#endif
@@ -0,0 +1,203 @@
+/*
+ * scheduler.cpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <functional>
+#include "scheduler.hpp"
+
+/*
+ * Scheduler constructor (zero threads sizes the pool to the machine)
+ */
+scheduler::scheduler(size_t threads, size_t quantum) : workers(threads), quantum(quantum), cursor(0),
+		first(0) {
+	return;
+}
+
+/*
+ * Scheduler destructor
+ */
+scheduler::~scheduler(void) {
+	for(size_t i = 0; i < guests.size(); ++i) {
+		delete guests[i]->cpu;
+		delete guests[i];
+	}
+}
+
+/*
+ * Return a guest's accounting (valid between rounds)
+ */
+const scheduler::account &scheduler::accounting(size_t guest) {
+	return guests.at(guest)->acct;
+}
+
+/*
+ * Add a guest running an image loaded at an offset, returning its index
+ */
+size_t scheduler::add(const std::vector<word> &image, word offset, word engine) {
+	guest *entry = new guest;
+
+	entry->cpu = new dcpu(engine);
+	entry->state = READY;
+	entry->acct = account();
+	if(!image.empty())
+		entry->cpu->memory().set(offset, std::min<dword>(image.size(), COUNT - offset), &image[0]);
+	guests.push_back(entry);
+	return guests.size() - 1;
+}
+
+/*
+ * Return a guest cpu (valid between rounds)
+ */
+dcpu &scheduler::at(size_t guest) {
+	return *guests.at(guest)->cpu;
+}
+
+/*
+ * Park a guest, skipping it until it is woken
+ */
+void scheduler::park(size_t guest) {
+	std::lock_guard<std::mutex> guard(lock);
+	if(guests.at(guest)->state == READY)
+		guests[guest]->state = PARKED;
+}
+
+/*
+ * Return the number of guests ready to run
+ */
+size_t scheduler::ready(void) {
+	std::lock_guard<std::mutex> guard(lock);
+	size_t count = 0;
+
+	for(size_t i = 0; i < guests.size(); ++i)
+		if(guests[i]->state == READY)
+			++count;
+	return count;
+}
+
+/*
+ * Run one quantum on every ready guest, returning the number of guests run
+ */
+size_t scheduler::round(void) {
+
+	// collect ready guests
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		runnable.clear();
+		for(size_t i = 0; i < guests.size(); ++i)
+			if(guests[i]->state == READY)
+				runnable.push_back(guests[i]);
+	}
+	if(runnable.empty())
+		return 0;
+
+	// rotate the first guest so no guest is always run last
+	first = (first + 1) % runnable.size();
+	cursor = 0;
+	start = std::chrono::steady_clock::now();
+
+	// workers claim guests in chunks until none are left
+	for(size_t i = 0; i < workers.size(); ++i)
+		workers.submit(std::bind(&scheduler::run_slice, this));
+	workers.wait();
+	return runnable.size();
+}
+
+/*
+ * Run rounds until no guest is ready or a number of rounds has run
+ * (zero runs without a limit), returning the number of rounds run
+ */
+size_t scheduler::run(size_t rounds) {
+	size_t count = 0;
+
+	while((!rounds || count < rounds)
+			&& round())
+		++count;
+	return count;
+}
+
+/*
+ * Run one quantum on a guest
+ */
+void scheduler::run_guest(guest &entry) {
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	size_t cycle = entry.cpu->cycles();
+	word reason;
+
+	// record delivery delay
+	entry.acct.wait = std::chrono::duration<double>(begin - start).count();
+	entry.acct.wait_max = std::max(entry.acct.wait_max, entry.acct.wait);
+
+	// run quantum
+	reason = entry.cpu->run(quantum);
+	entry.acct.cycle += entry.cpu->cycles() - cycle;
+	entry.acct.wall += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	++entry.acct.quanta;
+
+	// guests stopped at a breakpoint or idle loop wait for the host
+	if(reason != dcpu::BUDGET) {
+		std::lock_guard<std::mutex> guard(lock);
+		entry.state = (reason == dcpu::BREAKPOINT || reason == dcpu::IDLE) ? PARKED : HALTED;
+	}
+}
+
+/*
+ * Run runnable guests until none are left to claim
+ */
+void scheduler::run_slice(void) {
+	size_t count = runnable.size();
+
+	for(;;) {
+		size_t begin = cursor.fetch_add(CHUNK);
+		if(begin >= count)
+			return;
+		for(size_t i = begin; i < std::min(begin + CHUNK, count); ++i)
+			run_guest(*runnable[(first + i) % count]);
+	}
+}
+
+/*
+ * Return the number of guests
+ */
+size_t scheduler::size(void) {
+	return guests.size();
+}
+
+/*
+ * Return a guest's state
+ */
+word scheduler::state(size_t guest) {
+	std::lock_guard<std::mutex> guard(lock);
+	return guests.at(guest)->state;
+}
+
+/*
+ * Return the number of worker threads
+ */
+size_t scheduler::threads(void) {
+	return workers.size();
+}
+
+/*
+ * Wake a parked guest
+ */
+void scheduler::wake(size_t guest) {
+	std::lock_guard<std::mutex> guard(lock);
+	if(guests.at(guest)->state == PARKED)
+		guests[guest]->state = READY;
+}
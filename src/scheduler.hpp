@@ -0,0 +1,202 @@
+/*
+ * scheduler.hpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCHEDULER_HPP_
+#define SCHEDULER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include "dcpu.hpp"
+#include "pool.hpp"
+#include "types.hpp"
+
+class scheduler {
+public:
+
+	/*
+	 * Default cycles per quantum
+	 */
+	static const size_t QUANTUM = 0x1000;
+
+	/*
+	 * Guests claimed by a worker at a time
+	 */
+	static const size_t CHUNK = 0x10;
+
+	/*
+	 * Guest states (guests are parked by the host, or on reaching a
+	 * breakpoint or an idle loop)
+	 */
+	enum STATE { READY, PARKED, HALTED };
+
+	/*
+	 * Guest accounting (cycles consumed, seconds spent running, quanta
+	 * run, and the delay from the start of a round to the guest's last
+	 * and longest quantum)
+	 */
+	typedef struct {
+		size_t cycle;
+		double wall;
+		size_t quanta;
+		double wait;
+		double wait_max;
+	} account;
+
+	/*
+	 * Scheduler constructor (zero threads sizes the pool to the machine)
+	 */
+	scheduler(size_t threads = 0, size_t quantum = QUANTUM);
+
+	/*
+	 * Scheduler destructor
+	 */
+	virtual ~scheduler(void);
+
+	/*
+	 * Return a guest's accounting (valid between rounds)
+	 */
+	const account &accounting(size_t guest);
+
+	/*
+	 * Add a guest running an image loaded at an offset, returning its index
+	 */
+	size_t add(const std::vector<word> &image, word offset = 0, word engine = dcpu::INTERP);
+
+	/*
+	 * Return a guest cpu (valid between rounds)
+	 */
+	dcpu &at(size_t guest);
+
+	/*
+	 * Park a guest, skipping it until it is woken
+	 */
+	void park(size_t guest);
+
+	/*
+	 * Return the number of guests ready to run
+	 */
+	size_t ready(void);
+
+	/*
+	 * Run one quantum on every ready guest, returning the number of guests run
+	 */
+	size_t round(void);
+
+	/*
+	 * Run rounds until no guest is ready or a number of rounds has run
+	 * (zero runs without a limit), returning the number of rounds run
+	 */
+	size_t run(size_t rounds = 0);
+
+	/*
+	 * Return the number of guests
+	 */
+	size_t size(void);
+
+	/*
+	 * Return a guest's state
+	 */
+	word state(size_t guest);
+
+	/*
+	 * Return the number of worker threads
+	 */
+	size_t threads(void);
+
+	/*
+	 * Wake a parked guest (an idle guest is woken once the host has
+	 * changed its state, or it parks again)
+	 */
+	void wake(size_t guest);
+
+private:
+
+	/*
+	 * Hosted guest
+	 */
+	typedef struct {
+		dcpu *cpu;
+		word state;
+		account acct;
+	} guest;
+
+	/*
+	 * Worker pool
+	 */
+	pool workers;
+
+	/*
+	 * Cycles per quantum
+	 */
+	size_t quantum;
+
+	/*
+	 * Guests
+	 */
+	std::vector<guest *> guests;
+
+	/*
+	 * Guests run this round
+	 */
+	std::vector<guest *> runnable;
+
+	/*
+	 * Next runnable guest to be claimed
+	 */
+	std::atomic<size_t> cursor;
+
+	/*
+	 * Runnable guest run first this round (rotates every round)
+	 */
+	size_t first;
+
+	/*
+	 * Round start time
+	 */
+	std::chrono::steady_clock::time_point start;
+
+	/*
+	 * Guest state lock
+	 */
+	std::mutex lock;
+
+	/*
+	 * Scheduler constructor
+	 */
+	scheduler(const scheduler &other);
+
+	/*
+	 * Scheduler assignment operator
+	 */
+	scheduler &operator=(const scheduler &other);
+
+	/*
+	 * Run one quantum on a guest
+	 */
+	void run_guest(guest &entry);
+
+	/*
+	 * Run runnable guests until none are left to claim
+	 */
+	void run_slice(void);
+};
+
+#endif
@@ -0,0 +1,177 @@
+/*
+ * snapshot.cpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include "snapshot.hpp"
+
+std::atomic<size_t> snapshot::next(1);
+
+/*
+ * Snapshot constructor (a reset cpu with cleared memory)
+ */
+snapshot::snapshot(void) : id(next++) {
+	for(word i = 0; i < dcpu::REG_COUNT; ++i)
+		ctx.reg[i] = LOW;
+	ctx.state = dcpu::INIT;
+	ctx.cycle = 0;
+}
+
+/*
+ * Snapshot constructor
+ */
+snapshot::snapshot(const snapshot &other) : id(other.id), ctx(other.ctx) {
+	for(word i = 0; i < mem128::PAGE_COUNT; ++i)
+		page_table[i] = other.page_table[i];
+}
+
+/*
+ * Snapshot constructor (copies every page of a cpu)
+ */
+snapshot::snapshot(dcpu &cpu) {
+	capture(cpu, NULL);
+}
+
+/*
+ * Snapshot constructor (shares pages a cpu has not written since
+ * it was last synced with base, copying only the others)
+ */
+snapshot::snapshot(dcpu &cpu, snapshot &base) {
+	capture(cpu, &base);
+}
+
+/*
+ * Snapshot destructor
+ */
+snapshot::~snapshot(void) {
+	return;
+}
+
+/*
+ * Snapshot assignment operator
+ */
+snapshot &snapshot::operator=(const snapshot &other) {
+
+	// check for self
+	if(this == &other)
+		return *this;
+
+	// set attributes
+	id = other.id;
+	ctx = other.ctx;
+	for(word i = 0; i < mem128::PAGE_COUNT; ++i)
+		page_table[i] = other.page_table[i];
+	return *this;
+}
+
+/*
+ * Copy pages of a cpu, sharing those unchanged since base
+ */
+void snapshot::capture(dcpu &cpu, snapshot *base) {
+	static const page zero = {};
+	mem128 &mem = cpu.mem;
+	bool synced = base && mem.source == base->id;
+
+	id = next++;
+	ctx = cpu.ctx;
+	for(word i = 0; i < mem128::PAGE_COUNT; ++i) {
+		word offset = i * mem128::PAGE_LEN;
+
+		// share unwritten pages
+		if(synced
+				&& !mem.written(offset, mem.source_epoch)) {
+			page_table[i] = base->page_table[i];
+			continue;
+		}
+
+		// copy non-zero pages
+		if(!std::memcmp(&mem.at(offset), zero.words, sizeof(zero.words))) {
+			page_table[i].reset();
+			continue;
+		}
+		page *copy = new page;
+		std::memcpy(copy->words, &mem.at(offset), sizeof(copy->words));
+		page_table[i].reset(copy);
+	}
+
+	// memory now matches this snapshot
+	mem.source = id;
+	mem.source_epoch = mem.checkpoint();
+}
+
+/*
+ * Return the cycle count the snapshot was taken at
+ */
+size_t snapshot::cycles(void) {
+	return ctx.cycle;
+}
+
+/*
+ * Return the number of non-zero pages held
+ */
+size_t snapshot::pages(void) {
+	size_t count = 0;
+
+	for(word i = 0; i < mem128::PAGE_COUNT; ++i)
+		if(page_table[i])
+			++count;
+	return count;
+}
+
+/*
+ * Restore a cpu (copies only pages written since the cpu was last
+ * synced with this snapshot, or every page otherwise)
+ */
+void snapshot::restore(dcpu &cpu) {
+	mem128 &mem = cpu.mem;
+	bool synced = mem.source == id;
+
+	for(word i = 0; i < mem128::PAGE_COUNT; ++i) {
+		word offset = i * mem128::PAGE_LEN;
+
+		// skip pages unwritten since the last sync
+		if(synced
+				&& !mem.written(offset, mem.source_epoch))
+			continue;
+
+		// copy page (invalidating any code cached from it)
+		if(page_table[i])
+			std::memcpy(&mem.at(offset), page_table[i]->words, sizeof(page_table[i]->words));
+		else
+			std::memset(&mem.at(offset), 0, mem128::PAGE_LEN * sizeof(word));
+		mem.touch(offset);
+	}
+	cpu.ctx = ctx;
+
+	// memory now matches this snapshot
+	mem.source = id;
+	mem.source_epoch = mem.checkpoint();
+}
+
+/*
+ * Return the number of pages held by both snapshots
+ */
+size_t snapshot::shared(const snapshot &other) {
+	size_t count = 0;
+
+	for(word i = 0; i < mem128::PAGE_COUNT; ++i)
+		if(page_table[i]
+				&& page_table[i] == other.page_table[i])
+			++count;
+	return count;
+}
@@ -0,0 +1,119 @@
+/*
+ * snapshot.hpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SNAPSHOT_HPP_
+#define SNAPSHOT_HPP_
+
+#include <atomic>
+#include <memory>
+#include "dcpu.hpp"
+#include "mem128.hpp"
+#include "types.hpp"
+
+class snapshot {
+public:
+
+	/*
+	 * Snapshot constructor (a reset cpu with cleared memory)
+	 */
+	snapshot(void);
+
+	/*
+	 * Snapshot constructor
+	 */
+	snapshot(const snapshot &other);
+
+	/*
+	 * Snapshot constructor (copies every page of a cpu)
+	 */
+	snapshot(dcpu &cpu);
+
+	/*
+	 * Snapshot constructor (shares pages a cpu has not written since
+	 * it was last synced with base, copying only the others)
+	 */
+	snapshot(dcpu &cpu, snapshot &base);
+
+	/*
+	 * Snapshot destructor
+	 */
+	virtual ~snapshot(void);
+
+	/*
+	 * Snapshot assignment operator
+	 */
+	snapshot &operator=(const snapshot &other);
+
+	/*
+	 * Return the cycle count the snapshot was taken at
+	 */
+	size_t cycles(void);
+
+	/*
+	 * Return the number of non-zero pages held
+	 */
+	size_t pages(void);
+
+	/*
+	 * Return the number of pages held by both snapshots
+	 */
+	size_t shared(const snapshot &other);
+
+	/*
+	 * Restore a cpu (copies only pages written since the cpu was last
+	 * synced with this snapshot, or every page otherwise)
+	 */
+	void restore(dcpu &cpu);
+
+private:
+
+	/*
+	 * Memory page
+	 */
+	typedef struct {
+		word words[mem128::PAGE_LEN];
+	} page;
+
+	/*
+	 * Next snapshot id
+	 */
+	static std::atomic<size_t> next;
+
+	/*
+	 * Snapshot id (shared by copies, which hold the same pages)
+	 */
+	size_t id;
+
+	/*
+	 * Execution state
+	 */
+	dcpu::context ctx;
+
+	/*
+	 * Pages (shared between snapshots, null for zero pages)
+	 */
+	std::shared_ptr<const page> page_table[mem128::PAGE_COUNT];
+
+	/*
+	 * Copy pages of a cpu, sharing those unchanged since base
+	 */
+	void capture(dcpu &cpu, snapshot *base);
+};
+
+#endif
@@ -0,0 +1,43 @@
+/*
+ * trace.cpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include "tracer.hpp"
+
+/*
+ * Main (print a trace file as text)
+ */
+int main(int argc, char *argv[]) {
+	size_t count = SIZE_MAX;
+
+	// check input
+	if(argc < 2
+			|| argc > 3) {
+		std::cerr << "Usage: " << argv[0] << " PATH [COUNT]" << std::endl;
+		return 1;
+	}
+	if(argc == 3)
+		count = std::strtoul(argv[2], NULL, 0);
+	if(!tracer::decode(argv[1], std::cout, count)) {
+		std::cerr << "Exception: \'" << argv[1] << "\' (Malformed trace file)" << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,425 @@
+/*
+ * tracer.cpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include "decode.hpp"
+#include "disasm.hpp"
+#include "tracer.hpp"
+
+/*
+ * Register names (flat register order)
+ */
+static const char *REG_NAME[] = {
+	"A", "B", "C", "X", "Y", "Z", "I", "J", "SP", "PC", "O",
+};
+
+/*
+ * Returns if an operand value is read from memory
+ */
+static bool in_memory(word value) {
+	switch(decode::mode(value)) {
+		case decode::O_VAL:
+		case decode::O_OFF:
+		case decode::O_POP:
+		case decode::O_PEEK:
+		case decode::O_PUSH:
+		case decode::O_ADR:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Return the number of memory operands a command reads (JSR only
+ * reads B, reserved opcodes read nothing)
+ */
+static word memory_operands(const decode::op &entry) {
+	if(!entry.code)
+		return (entry.a == dcpu::JSR) ? in_memory(entry.b) : 0;
+	return in_memory(entry.a) + in_memory(entry.b);
+}
+
+/*
+ * Write a little endian word
+ */
+static halfword *put16(halfword *out, word value) {
+	*out++ = value;
+	*out++ = value >> 8;
+	return out;
+}
+
+/*
+ * Read a little endian word
+ */
+static word get16(const halfword *in) {
+	return in[0] | (in[1] << 8);
+}
+
+/*
+ * Tracer constructor (starts a thread writing a cpu's trace to a
+ * file at a given path)
+ */
+tracer::tracer(dcpu &cpu, const std::string &path) : cpu(cpu), reads(0), target(0), store(false), follow(0), cycle(SIZE_MAX), count(0),
+		waits(0), stop(false) {
+	halfword header[sizeof(word)];
+
+	std::memset(last, 0, sizeof(last));
+	current = new chunk();
+	file = std::fopen(path.c_str(), "wb");
+	if(!file)
+		return;
+	put16(header, MAGIC);
+	std::fwrite(header, 1, sizeof(header), file);
+
+	// one buffer is filled while the rest are free
+	for(size_t i = 1; i < CHUNK_COUNT; ++i)
+		empty.push(new chunk());
+	worker = std::thread(&tracer::drain, this);
+}
+
+/*
+ * Tracer destructor (writes remaining records)
+ */
+tracer::~tracer(void) {
+	chunk *buffer;
+
+	if(file) {
+		if(current->len)
+			next_chunk();
+		stop = true;
+		worker.join();
+		std::fclose(file);
+	}
+	delete current;
+	while(empty.pop(buffer))
+		delete buffer;
+}
+
+/*
+ * Read a trace file, writing up to a count of records as text
+ */
+bool tracer::decode(const std::string &path, std::ostream &out, size_t count) {
+	std::ifstream in(path.c_str(), std::ios::binary);
+	word reg[dcpu::REG_COUNT] = { 0 }, follow = 0;
+	size_t now = 0;
+	mem128 scratch;
+	char line[0x100];
+
+	// read trace file
+	if(!in)
+		return false;
+	std::vector<halfword> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	if(bytes.size() < sizeof(word)
+			|| get16(&bytes[0]) != MAGIC)
+		return false;
+
+	// print each record (cycle, address, command, registers, memory read
+	// & memory written)
+	for(size_t i = sizeof(word); i < bytes.size() && count; --count) {
+		const halfword *rec = &bytes[i], *end = &bytes[0] + bytes.size();
+		halfword flags = *rec++;
+		word pc = follow, next = (flags / F_NEXT) & 0x03, mask = 0;
+		size_t cost;
+
+		// command
+		if(end - rec < (ptrdiff_t) ((sizeof(word) * (1 + next)) + ((flags & F_JUMP) ? sizeof(word) : 0)
+				+ ((flags & F_WIDE) ? sizeof(word) : 1)))
+			return false;
+		if(flags & F_JUMP) {
+			pc = get16(rec);
+			rec += sizeof(word);
+		}
+		for(word j = 0; j <= next; ++j, rec += sizeof(word))
+			scratch.set(pc + j, get16(rec));
+		if(flags & F_WIDE) {
+			cost = get16(rec);
+			rec += sizeof(word);
+		} else
+			cost = *rec++;
+
+		// registers (all of them for a key record)
+		if(flags & F_KEY) {
+			if(end - rec < (ptrdiff_t) ((sizeof(word) * dcpu::REG_COUNT) + sizeof(uint64_t)))
+				return false;
+			for(word j = 0; j < dcpu::REG_COUNT; ++j, rec += sizeof(word))
+				reg[j] = get16(rec);
+			now = 0;
+			for(word j = 0; j < sizeof(uint64_t); ++j)
+				now |= (size_t) *rec++ << (8 * j);
+			now -= cost;
+			mask = (1 << dcpu::REG_COUNT) - 1;
+		} else {
+			if(end - rec < (ptrdiff_t) sizeof(word))
+				return false;
+			mask = get16(rec);
+			rec += sizeof(word);
+			for(word j = 0; j < dcpu::REG_COUNT; ++j)
+				if(mask & (1 << j)) {
+					if(end - rec < (ptrdiff_t) sizeof(word))
+						return false;
+					reg[j] = get16(rec);
+					rec += sizeof(word);
+				}
+		}
+		std::snprintf(line, sizeof(line), "%12zu  0x%04X  %-24s", now, pc, disasm::at(scratch, pc).c_str());
+		out << line;
+		for(word j = 0; j < dcpu::REG_COUNT; ++j)
+			if(mask & (1 << j)) {
+				std::snprintf(line, sizeof(line), " %s=0x%04X", REG_NAME[j], reg[j]);
+				out << line;
+			}
+
+		// memory read
+		for(word j = memory_operands(decode::at(scratch.at(pc))); j; --j) {
+			if(end - rec < (ptrdiff_t) (sizeof(word) * 2))
+				return false;
+			std::snprintf(line, sizeof(line), " read [0x%04X]=0x%04X", get16(rec), get16(rec + sizeof(word)));
+			out << line;
+			rec += sizeof(word) * 2;
+		}
+
+		// memory written
+		if(flags & F_STORE) {
+			if(end - rec < (ptrdiff_t) (sizeof(word) * 2))
+				return false;
+			std::snprintf(line, sizeof(line), " [0x%04X]=0x%04X", get16(rec), get16(rec + sizeof(word)));
+			out << line;
+			rec += sizeof(word) * 2;
+		}
+		out << std::endl;
+		follow = pc + 1 + next;
+		now += cost;
+		i = rec - &bytes[0];
+	}
+	return true;
+}
+
+/*
+ * Writer thread loop (drains full buffers to the trace file)
+ */
+void tracer::drain(void) {
+	chunk *buffer;
+
+	for(;;) {
+		bool done = stop;
+
+		while(full.pop(buffer)) {
+			std::fwrite(buffer->bytes, 1, buffer->len, file);
+			buffer->len = 0;
+			empty.push(buffer);
+		}
+		if(done)
+			break;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+/*
+ * Encode a record into the current buffer
+ *
+ * The first record of a run (any record whose cycle count does not
+ * follow the last) carries every register and the cycle count; the
+ * rest carry only registers the command changed, leaving out PC
+ * (records carry their address when they do not follow the last
+ * command). Operand values read from registers, literals & next words
+ * follow from the registers and the command; memory operands carry the
+ * address and value read. A command that writes memory carries the
+ * address and the value written. Next words, reads & the address
+ * written are taken by fetch before the command runs, so a command
+ * overwriting its own next word is recorded as it ran. The command a
+ * passing IF* runs is its own record.
+ */
+void tracer::encode(word address, word op, size_t cost) {
+	halfword *out = current->bytes + current->len, *start = out;
+	const decode::op &entry = decode::at(op);
+	const word *reg = cpu.ctx.reg;
+	word next = entry.length - 1, mask = 0;
+	bool key = (cycle != cpu.ctx.cycle - cost);
+	halfword flags = next * F_NEXT;
+
+	// command (address only if it does not follow the last command)
+	if(key
+			|| address != follow)
+		flags |= F_JUMP;
+	if(key)
+		flags |= F_KEY;
+	if(cost > 0xFF)
+		flags |= F_WIDE;
+	if(store)
+		flags |= F_STORE;
+	*out++ = flags;
+	if(flags & F_JUMP)
+		out = put16(out, address);
+	out = put16(out, op);
+	for(word i = 0; i < next; ++i)
+		out = put16(out, words[i]);
+	if(flags & F_WIDE)
+		out = put16(out, cost);
+	else
+		*out++ = cost;
+
+	// registers (every register for a key record)
+	if(key) {
+		for(word i = 0; i < dcpu::REG_COUNT; ++i)
+			out = put16(out, reg[i]);
+		for(word i = 0; i < sizeof(uint64_t); ++i)
+			*out++ = (uint64_t) cpu.ctx.cycle >> (8 * i);
+	} else {
+		halfword *mask_at = out;
+		out += sizeof(word);
+		for(word i = 0; i < dcpu::REG_COUNT; ++i)
+			if(i != dcpu::R_PC
+					&& reg[i] != last[i]) {
+				mask |= 1 << i;
+				out = put16(out, reg[i]);
+			}
+		put16(mask_at, mask);
+	}
+
+	// memory read
+	for(word i = 0; i < reads; ++i)
+		out = put16(out, read[i]);
+
+	// memory written
+	if(flags & F_STORE) {
+		out = put16(out, target);
+		out = put16(out, cpu.mem.at(target));
+	}
+	std::memcpy(last, reg, sizeof(last));
+	follow = address + 1 + next;
+	cycle = cpu.ctx.cycle;
+	current->len += out - start;
+	++count;
+}
+
+/*
+ * Note the next words, memory operands read & memory word written by a
+ * command at an address (called before it runs)
+ *
+ * Operands are resolved in the order the command resolves them (A,
+ * then B), moving a copy of SP for stack operands. Every command but
+ * IF* writes its A operand; JSR pushes its return address once B is
+ * resolved.
+ */
+void tracer::fetch(word address, word op) {
+	const decode::op &entry = decode::at(op);
+	const word *reg = cpu.ctx.reg;
+	word sp = reg[dcpu::R_SP], next = 0, location;
+	const halfword operands[] = { entry.a, entry.b };
+
+	reads = 0;
+	store = false;
+	for(word i = 1; i < entry.length; ++i)
+		words[i - 1] = cpu.mem.at(address + i);
+
+	// reserved opcodes read & write nothing
+	if(!entry.code
+			&& entry.a != dcpu::JSR)
+		return;
+	for(word i = entry.code ? 0 : 1; i < 2; ++i) {
+		switch(decode::mode(operands[i])) {
+			case decode::O_VAL:
+				location = reg[operands[i] % dcpu::M_REG_COUNT];
+				break;
+			case decode::O_OFF:
+				location = words[next++] + reg[operands[i] % dcpu::M_REG_COUNT];
+				break;
+			case decode::O_POP:
+				location = sp++;
+				break;
+			case decode::O_PEEK:
+				location = sp;
+				break;
+			case decode::O_PUSH:
+				location = --sp;
+				break;
+			case decode::O_ADR:
+				location = words[next++];
+				break;
+
+			// a next word is written in place, but not read from memory
+			case decode::O_NEXT:
+				if(!i
+						&& entry.code < dcpu::IFE) {
+					store = true;
+					target = address + 1;
+				}
+				++next;
+				continue;
+			default:
+				continue;
+		}
+		if(!i
+				&& entry.code < dcpu::IFE) {
+			store = true;
+			target = location;
+		}
+		read[reads++] = location;
+		read[reads++] = cpu.mem.at(location);
+	}
+	if(!entry.code) {
+		store = true;
+		target = sp - 1;
+	}
+}
+
+/*
+ * Returns if the trace file is open
+ */
+bool tracer::is_open(void) {
+	return file != NULL;
+}
+
+/*
+ * Queue the current buffer and take a free one
+ */
+void tracer::next_chunk(void) {
+
+	// discard records without a trace file
+	if(!file) {
+		current->len = 0;
+		return;
+	}
+	full.push(current);
+
+	// wait for the writer thread to free a buffer
+	while(!empty.pop(current)) {
+		++waits;
+		std::this_thread::yield();
+	}
+}
+
+/*
+ * Return the number of records written
+ */
+size_t tracer::records(void) {
+	return count;
+}
+
+/*
+ * Return the number of times the cpu waited for a free buffer
+ */
+size_t tracer::stalls(void) {
+	return waits;
+}
@@ -0,0 +1,248 @@
+/*
+ * tracer.hpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACER_HPP_
+#define TRACER_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <thread>
+#include "dcpu.hpp"
+#include "ring.hpp"
+#include "types.hpp"
+
+class tracer {
+public:
+
+	/*
+	 * Trace buffer size (bytes)
+	 */
+	static const size_t CHUNK_LEN = 0x10000;
+
+	/*
+	 * Trace buffers per tracer (a power of two)
+	 */
+	static const size_t CHUNK_COUNT = 0x20;
+
+	/*
+	 * Longest encoded record (bytes)
+	 */
+	static const size_t RECORD_LEN = 0x40;
+
+	/*
+	 * Trace file header
+	 */
+	static const word MAGIC = 0x4454;
+
+	/*
+	 * Run the command a passing IF* guards as its own step, so it is
+	 * traced at its own address
+	 */
+	static const bool SPLIT = true;
+
+	/*
+	 * Record flags
+	 *
+	 * F_JUMP:	address follows (the command does not follow the last one)
+	 * F_WIDE:	cost is two bytes
+	 * F_KEY:	full registers & cycle count follow (start of a run)
+	 * F_NEXT:	operand word count (two bits)
+	 * F_STORE:	address & value of the memory word written follow
+	 *
+	 * Address & value pairs of the memory operands a command read (its
+	 * A then B operand, through [register], [next word + register],
+	 * [next word] & the stack) always follow its registers, so their
+	 * count is known from the command.
+	 */
+	enum FLAG { F_JUMP = 0x01, F_WIDE = 0x02, F_KEY = 0x04, F_NEXT = 0x08, F_STORE = 0x20 };
+
+	/*
+	 * Tracer constructor (starts a thread writing a cpu's trace to a
+	 * file at a given path)
+	 */
+	tracer(dcpu &cpu, const std::string &path);
+
+	/*
+	 * Tracer destructor (writes remaining records)
+	 */
+	virtual ~tracer(void);
+
+	/*
+	 * Read a trace file, writing up to a count of records as text
+	 */
+	static bool decode(const std::string &path, std::ostream &out, size_t count = SIZE_MAX);
+
+	/*
+	 * Returns if the trace file is open
+	 */
+	bool is_open(void);
+
+	/*
+	 * Note the next words, memory operands read & memory word written
+	 * by a command at an address (called before it runs)
+	 */
+	void fetch(word address, word op);
+
+	/*
+	 * Record a command run at an address (called after it runs)
+	 */
+	void record(word address, word op, size_t cost) {
+		if(current->len + RECORD_LEN > CHUNK_LEN)
+			next_chunk();
+		encode(address, op, cost);
+	}
+
+	/*
+	 * Return the number of records written
+	 */
+	size_t records(void);
+
+	/*
+	 * Return the number of times the cpu waited for a free buffer
+	 */
+	size_t stalls(void);
+
+private:
+
+	/*
+	 * Trace buffer
+	 */
+	typedef struct {
+		size_t len;
+		halfword bytes[CHUNK_LEN];
+	} chunk;
+
+	/*
+	 * Traced cpu
+	 */
+	dcpu &cpu;
+
+	/*
+	 * Trace file
+	 */
+	std::FILE *file;
+
+	/*
+	 * Buffer being filled by the cpu
+	 */
+	chunk *current;
+
+	/*
+	 * Buffers waiting to be written
+	 */
+	ring<chunk *, CHUNK_COUNT> full;
+
+	/*
+	 * Buffers free to be filled
+	 */
+	ring<chunk *, CHUNK_COUNT> empty;
+
+	/*
+	 * Registers after the last record
+	 */
+	word last[dcpu::REG_COUNT];
+
+	/*
+	 * Next words of the command being run (as it was fetched, a command
+	 * may overwrite its own)
+	 */
+	word words[2];
+
+	/*
+	 * Address & value pairs of the memory operands read by the command
+	 * being run
+	 */
+	word read[4];
+
+	/*
+	 * Words held in read
+	 */
+	word reads;
+
+	/*
+	 * Address of the memory word the command being run writes
+	 */
+	word target;
+
+	/*
+	 * Command being run writes memory
+	 */
+	bool store;
+
+	/*
+	 * Address following the last record's command
+	 */
+	word follow;
+
+	/*
+	 * Cycle count after the last record (zero before the first record
+	 * of a run)
+	 */
+	size_t cycle;
+
+	/*
+	 * Records written
+	 */
+	size_t count;
+
+	/*
+	 * Waits for a free buffer
+	 */
+	size_t waits;
+
+	/*
+	 * Stop flag
+	 */
+	std::atomic<bool> stop;
+
+	/*
+	 * Writer thread
+	 */
+	std::thread worker;
+
+	/*
+	 * Tracer constructor
+	 */
+	tracer(const tracer &other);
+
+	/*
+	 * Tracer assignment operator
+	 */
+	tracer &operator=(const tracer &other);
+
+	/*
+	 * Writer thread loop (drains full buffers to the trace file)
+	 */
+	void drain(void);
+
+	/*
+	 * Encode a record into the current buffer
+	 */
+	void encode(word address, word op, size_t cost);
+
+	/*
+	 * Queue the current buffer and take a free one
+	 */
+	void next_chunk(void);
+};
+
+#endif
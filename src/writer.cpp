@@ -0,0 +1,115 @@
+/*
+ * writer.cpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "bswap.hpp"
+#include "writer.hpp"
+
+/*
+ * Writer constructor
+ */
+writer::writer(void) {
+	return;
+}
+
+/*
+ * Writer destructor
+ */
+writer::~writer(void) {
+	return;
+}
+
+/*
+ * Add a range of words (written in big endian order)
+ */
+void writer::add(const word *words, dword count) {
+	range entry;
+
+	entry.words = words;
+	entry.count = count;
+	ranges.push_back(entry);
+}
+
+/*
+ * Remove all ranges
+ */
+void writer::clear(void) {
+	ranges.clear();
+}
+
+/*
+ * Write all ranges to file at a given path with a single vectored write
+ */
+bool writer::write(const std::string &path) {
+	std::vector<struct iovec> vec(ranges.size());
+	size_t total = 0, offset = 0;
+	int fd;
+
+	for(size_t i = 0; i < ranges.size(); ++i)
+		total += ranges[i].count;
+
+	// swap ranges into the staging buffer in one pass (or write them
+	// in place when the host is big endian)
+	if(bswap_needed(BIG))
+		staging.resize(total);
+	for(size_t i = 0; i < ranges.size(); ++i) {
+		const word *words = ranges[i].words;
+		if(bswap_needed(BIG)) {
+			bswap_copy(&staging[offset], words, ranges[i].count, BIG);
+			words = &staging[offset];
+		}
+		vec[i].iov_base = const_cast<word *>(words);
+		vec[i].iov_len = ranges[i].count * sizeof(word);
+		offset += ranges[i].count;
+	}
+
+	// attempt to open file at path
+	fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0)
+		return false;
+
+	// write ranges, resuming after partial or interrupted writes
+	struct iovec *next = vec.empty() ? NULL : &vec[0];
+	size_t left = vec.size();
+	while(left) {
+		ssize_t count = writev(fd, next, left);
+		if(count < 0) {
+			if(errno == EINTR)
+				continue;
+			::close(fd);
+			return false;
+		}
+
+		// skip written ranges
+		while(left
+				&& (size_t) count >= next->iov_len) {
+			count -= next->iov_len;
+			++next;
+			--left;
+		}
+		if(left) {
+			next->iov_base = static_cast<halfword *>(next->iov_base) + count;
+			next->iov_len -= count;
+		}
+	}
+	return !::close(fd);
+}
@@ -0,0 +1,86 @@
+/*
+ * writer.hpp
+ * Copyright (C) 2012 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WRITER_HPP_
+#define WRITER_HPP_
+
+#include <string>
+#include <vector>
+#include "types.hpp"
+
+class writer {
+public:
+
+	/*
+	 * Writer constructor
+	 */
+	writer(void);
+
+	/*
+	 * Writer destructor
+	 */
+	virtual ~writer(void);
+
+	/*
+	 * Add a range of words (written in big endian order)
+	 */
+	void add(const word *words, dword count);
+
+	/*
+	 * Remove all ranges
+	 */
+	void clear(void);
+
+	/*
+	 * Write all ranges to file at a given path with a single vectored write
+	 */
+	bool write(const std::string &path);
+
+private:
+
+	/*
+	 * Word range
+	 */
+	typedef struct {
+		const word *words;
+		dword count;
+	} range;
+
+	/*
+	 * Ranges in write order
+	 */
+	std::vector<range> ranges;
+
+	/*
+	 * Staging buffer (ranges swapped to big endian)
+	 */
+	std::vector<word> staging;
+
+	/*
+	 * Writer constructor
+	 */
+	writer(const writer &other);
+
+	/*
+	 * Writer assignment operator
+	 */
+	writer &operator=(const writer &other);
+};
+
+#endif